@@ -1,5 +1,5 @@
 QT       += core gui
-QT       += core gui multimedia multimediawidgets
+QT       += core gui multimedia multimediawidgets network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -11,14 +11,51 @@ CONFIG += c++17
 
 SOURCES += \
     alertedobjects.cpp \
-    indetectionobjects.cpp \
+    alertstream.cpp \
+    appsettings.cpp \
+    benchmarks.cpp \
+    detectionengine.cpp \
+    detectionfilter.cpp \
+    detectorprofile.cpp \
+    enginehost.cpp \
+    frameclock.cpp \
+    framepool.cpp \
+    framerecorder.cpp \
+    framescheduler.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    pipelinepolicies.cpp \
+    regionofinterest.cpp \
+    retentionmanager.cpp \
+    ruletracker.cpp \
+    sharedframering.cpp \
+    snapshotdeduplicator.cpp \
+    snapshotwriter.cpp \
+    timerwheel.cpp
 
 HEADERS += \
     alertedobjects.h \
-    indetectionobjects.h \
-    mainwindow.h
+    alertstream.h \
+    appsettings.h \
+    benchmarks.h \
+    detectionengine.h \
+    detectionfilter.h \
+    detectionpipeline.h \
+    detectorprofile.h \
+    enginehost.h \
+    frameclock.h \
+    framepool.h \
+    framerecorder.h \
+    framescheduler.h \
+    mainwindow.h \
+    pipelinepolicies.h \
+    regionofinterest.h \
+    retentionmanager.h \
+    ruletracker.h \
+    sharedframering.h \
+    snapshotdeduplicator.h \
+    snapshotwriter.h \
+    timerwheel.h
 
 FORMS += \
     mainwindow.ui
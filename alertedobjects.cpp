@@ -1,11 +1,12 @@
 #include "alertedobjects.h"
+#include "alertstream.h"
 
 /**
  * Saves the current alerted objects to a JSON file.
  * 
  * This function iterates over the alerted objects container, converting each
  * alerted object into a JSON object with fields for id, imgPath, date, hour,
- * and camera. The JSON objects are added to a JSON array, which is then 
+ * camera and occurrences. The JSON objects are added to a JSON array, which is then 
  * serialized to a JSON document and saved to the specified file. If the file
  * cannot be opened for writing, a warning message is logged.
  * 
@@ -16,14 +17,7 @@ void alertedObjects::saveAlerts(QString filename) {
 
     // Iterate over the container and convert each alerted object to a JSON object
     for (auto it = alertedContainer.cbegin(); it != alertedContainer.cend(); ++it) {
-        QJsonObject jsonObject;
-        jsonObject["id"] = it.key(); // Agregar la llave como un campo
-        jsonObject["imgPath"] = it.value().imgPath;
-        jsonObject["date"] = it.value().date.toString(Qt::ISODate);
-        jsonObject["hour"] = it.value().hour.toString(Qt::ISODate);
-        jsonObject["camera"] = it.value().camera;
-
-        jsonArray.append(jsonObject);
+        jsonArray.append(alertToJson(it.key(), it.value()));
     }
 
     // Create and save the JSON document
@@ -42,7 +36,7 @@ void alertedObjects::saveAlerts(QString filename) {
  * 
  * This function checks if the specified JSON file exists and can be opened for reading.
  * It reads and parses the JSON data, expecting an array of JSON objects with fields
- * "id", "imgPath", "date", "hour", and "camera". Each valid JSON object is converted
+ * "id", "imgPath", "date", "hour", and "camera" (and optionally "occurrences"). Each valid JSON object is converted
  * to an `alerted` object and inserted into the `alertedContainer`. If any JSON object
  * contains invalid or incomplete data, it is skipped, and a warning message is logged.
  * The current contents of the `alertedContainer` are cleared before loading new data.
@@ -90,6 +84,7 @@ void alertedObjects::loadAlerts(QString filename) {
         QDate date = QDate::fromString(jsonObject["date"].toString(), Qt::ISODate);
         QTime hour = QTime::fromString(jsonObject["hour"].toString(), Qt::ISODate);
         int camera = jsonObject["camera"].toInt(-1);
+        int occurrences = jsonObject["occurrences"].toInt(1);
 
         if (id.isEmpty() || imgPath.isEmpty() || !date.isValid() || !hour.isValid() || camera == -1) {
             qWarning() << "Datos incompletos o inválidos en JSON, omitiendo entrada con id:" << id;
@@ -97,7 +92,7 @@ void alertedObjects::loadAlerts(QString filename) {
         }
 
         // Insert the valid JSON object into the container
-        alertedContainer.insert(id, alerted(imgPath, date, hour, camera));
+        alertedContainer.insert(id, alerted(imgPath, date, hour, camera, occurrences));
     }
 
     for (auto it = alertedContainer.cbegin(); it != alertedContainer.cend(); ++it) {
@@ -114,17 +109,97 @@ void alertedObjects::loadAlerts(QString filename) {
  * 
  * This function adds a new entry to the alertedContainer with the specified
  * id, imgPath, currentDate, hour, and camera. If the id already exists in the
- * container, its associated alerted object will be updated.
+ * container, its associated alerted object will be updated. If a stream is
+ * set, the alert is also published as an event.
  * @param id The identifier for the new alerted object.
  * @param imgPath The path to the image associated with the alert.
  * @param currentDate The current date.
  * @param hour The current time.
  * @param camera The number of the camera where the alert was detected.
+ * @param occurrences The number of alerts already merged into this one, 1 for a new alert.
  */
-void alertedObjects::insertAlerted(const QString &id, const QString &imgPath, const QDate &currentDate, const QTime &hour, int camera) {
+void alertedObjects::insertAlerted(const QString &id, const QString &imgPath, const QDate &currentDate, const QTime &hour, int camera,
+                                   int occurrences) {
     qDebug() << "Adding" << id << "to alerts...";
-    alertedContainer[id] = alerted(imgPath, currentDate, hour, camera);
+    alertedContainer[id] = alerted(imgPath, currentDate, hour, camera, qMax(1, occurrences));
     qDebug() << "Container size:" << alertedContainer.size();
+
+    if (stream) {
+        QJsonObject event = alertToJson(id, alertedContainer[id]);
+        event["type"] = "alert";
+        stream->publish(event);
+    }
+}
+
+/**
+ * Merges a near-duplicate alert into an existing one, increasing its number
+ * of occurrences instead of storing a new entry and a new snapshot.
+ * @param id The identifier of the existing alerted object.
+ * @return True if the alert exists and was updated, false otherwise.
+ */
+bool alertedObjects::mergeAlerted(const QString &id) {
+    auto it = alertedContainer.find(id);
+    if (it == alertedContainer.end()) {
+        return false;
+    }
+
+    it.value().occurrences++;
+    qDebug() << "Merged duplicate into" << id << "occurrences:" << it.value().occurrences;
+
+    if (stream) {
+        QJsonObject event = alertToJson(id, it.value());
+        event["type"] = "merge";
+        stream->publish(event);
+    }
+    return true;
+}
+
+/**
+ * Removes an alerted object, publishing the removal if a stream is set.
+ * The snapshot file is not touched; the retention manager deletes it after
+ * the record is gone.
+ * @param id The identifier of the alerted object.
+ * @return True if the alert existed.
+ */
+bool alertedObjects::removeAlerted(const QString &id) {
+    if (alertedContainer.remove(id) == 0) {
+        return false;
+    }
+
+    if (stream) {
+        QJsonObject event;
+        event["id"] = id;
+        event["type"] = "remove";
+        stream->publish(event);
+    }
+    return true;
+}
+
+/**
+ * Sets the stream where insertions, merges and removals are published.
+ * Loading alerts from a file does not publish anything.
+ * @param stream The stream, or nullptr to stop publishing.
+ */
+void alertedObjects::setStream(alertStream *stream) {
+    this->stream = stream;
+}
+
+/**
+ * Converts an alerted object to a JSON object with fields for id, imgPath,
+ * date, hour, camera and occurrences. Used for the file and the event stream.
+ * @param id The identifier of the alerted object.
+ * @param alert The alerted object.
+ * @return The JSON object.
+ */
+QJsonObject alertedObjects::alertToJson(const QString &id, const alerted &alert) {
+    QJsonObject jsonObject;
+    jsonObject["id"] = id; // Agregar la llave como un campo
+    jsonObject["imgPath"] = alert.imgPath;
+    jsonObject["date"] = alert.date.toString(Qt::ISODate);
+    jsonObject["hour"] = alert.hour.toString(Qt::ISODate);
+    jsonObject["camera"] = alert.camera;
+    jsonObject["occurrences"] = alert.occurrences;
+    return jsonObject;
 }
 
 /**
@@ -185,3 +260,11 @@ alertedObjects::alerted alertedObjects::operator[](QString key) {
 bool alertedObjects::contains(QString &key) {
     return alertedContainer.contains(key);
 }
+
+/**
+ * Returns a copy of the container, with the id of each alerted object.
+ * @return The alerted objects by id.
+ */
+QMap<QString, alertedObjects::alerted> alertedObjects::getAlerted() const {
+    return alertedContainer;
+}
@@ -10,6 +10,8 @@
 #include <QFile>
 #include <QTextStream>
 
+class alertStream;
+
 // Class to load and store the alerted objects, with sorter f
 class alertedObjects {
 public:
@@ -19,13 +21,14 @@ public:
         QDate date;
         QTime hour;
         int camera;
+        int occurrences; // Number of near-duplicate alerts merged into this one
 
         // Default constructor
-        alerted() : imgPath(""), date(QDate::currentDate()), hour(QTime::currentTime()), camera(-1) {}
+        alerted() : imgPath(""), date(QDate::currentDate()), hour(QTime::currentTime()), camera(-1), occurrences(1) {}
 
         // Initial value constructor
-        alerted(const QString &_imgPath, const QDate &_date, const QTime &_hour, int _camera)
-            : imgPath(_imgPath), date(_date), hour(_hour), camera(_camera) {}
+        alerted(const QString &_imgPath, const QDate &_date, const QTime &_hour, int _camera, int _occurrences = 1)
+            : imgPath(_imgPath), date(_date), hour(_hour), camera(_camera), occurrences(_occurrences) {}
     };
 
     // Save alerts
@@ -35,7 +38,17 @@ public:
     void loadAlerts(QString filename);
 
     // Insert alert
-    void insertAlerted(const QString &id, const QString &imgPath, const QDate &currentDate, const QTime &hour, int camera);
+    void insertAlerted(const QString &id, const QString &imgPath, const QDate &currentDate, const QTime &hour, int camera,
+                       int occurrences = 1);
+
+    // Merge a duplicate alert into an existing one
+    bool mergeAlerted(const QString &id);
+
+    // Remove an alert (retention)
+    bool removeAlerted(const QString &id);
+
+    // Publish insertions and merges as events
+    void setStream(alertStream *stream);
 
     // Sorter funcions
     QList<alerted> getSortedByCamera();
@@ -45,10 +58,17 @@ public:
     // Operation functions
     alerted operator[](QString key);
     bool contains(QString &key);
+    QMap<QString, alerted> getAlerted() const;
 
 private:
     // Container
     QMap<QString, alerted> alertedContainer; // Mapa que almacena IDs y sus detecciones
+
+    // Optional event stream for other processes
+    alertStream *stream = nullptr;
+
+    // Private helper functions
+    static QJsonObject alertToJson(const QString &id, const alerted &alert);
 };
 
 #endif // ALERTEDOBJECTS_H
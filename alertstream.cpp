@@ -0,0 +1,210 @@
+#include "alertstream.h"
+
+#include <QJsonDocument>
+#include <QDebug>
+
+/**
+ * Constructor for alertStream.
+ * Events are flushed to the subscribers every 100 ms unless configured otherwise.
+ * @param parent The parent QObject.
+ */
+alertStream::alertStream(QObject *parent) : QObject(parent) {
+    server = new QLocalServer(this);
+    connect(server, &QLocalServer::newConnection, this, &alertStream::onNewConnection);
+
+    flushTimer = new QTimer(this);
+    connect(flushTimer, &QTimer::timeout, this, &alertStream::flush);
+    flushTimer->start(100);
+}
+
+/**
+ * Applies the "alertStream" section of the settings.
+ * @param json Object with optional "flushIntervalMs" and "historySize".
+ */
+void alertStream::configure(const QJsonObject &json) {
+    flushTimer->setInterval(qMax(1, json["flushIntervalMs"].toInt(flushTimer->interval())));
+    historySize = qMax(1, json["historySize"].toInt(historySize));
+}
+
+/**
+ * Starts accepting subscribers on a local socket.
+ * @param name The name of the socket.
+ * @return True if the server is listening.
+ */
+bool alertStream::listen(const QString &name) {
+    QLocalServer::removeServer(name);
+    if (!server->listen(name)) {
+        qWarning() << "No se pudo abrir el socket de alertas:" << server->errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Publishes an event to every subscriber.
+ *
+ * The event is numbered and encoded once as a JSON line
+ * ({"seq": N, "event": {...}}) and appended to the history, which all the
+ * subscribers read through their own cursor. Nothing is written here: the
+ * flush timer sends the pending events in batches.
+ *
+ * @param event The event to publish.
+ */
+void alertStream::publish(const QJsonObject &event) {
+    QJsonObject line;
+    line["seq"] = static_cast<qint64>(nextSequence);
+    line["event"] = event;
+
+    history.enqueue(QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n');
+    nextSequence++;
+
+    if (history.size() > historySize) {
+        history.dequeue();
+        firstSequence++;
+    }
+}
+
+/**
+ * Returns the sequence of the last published event, 0 if there is none.
+ */
+quint64 alertStream::lastSequence() const {
+    return nextSequence - 1;
+}
+
+/**
+ * Slot for new connections. The subscriber waits for its subscription line.
+ */
+void alertStream::onNewConnection() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        subscriber sub;
+        sub.socket = socket;
+        sub.nextSequence = nextSequence;
+        subscribers.append(sub);
+
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+/**
+ * Sends the pending events to every subscriber and forgets the disconnected ones.
+ */
+void alertStream::flush() {
+    for (int i = subscribers.size() - 1; i >= 0; i--) {
+        subscriber &sub = subscribers[i];
+
+        if (!sub.socket || sub.socket->state() != QLocalSocket::ConnectedState) {
+            subscribers.removeAt(i);
+            continue;
+        }
+
+        if (!sub.subscribed) {
+            readSubscription(sub);
+        }
+        if (sub.subscribed) {
+            deliver(sub);
+        }
+    }
+}
+
+/**
+ * Reads the subscription line of a subscriber, if it arrived.
+ *
+ * The line is a JSON object {"subscribe": {"from": N, "policy": "drop-oldest"
+ * or "block", "queue": M}}. "from" asks for a replay starting at sequence N
+ * (default: only new events), "queue" is the number of pending events the
+ * subscriber accepts before the policy applies.
+ *
+ * @param sub The subscriber.
+ */
+void alertStream::readSubscription(subscriber &sub) {
+    if (!sub.socket->canReadLine()) {
+        return;
+    }
+
+    QJsonObject request = QJsonDocument::fromJson(sub.socket->readLine()).object()["subscribe"].toObject();
+
+    sub.policy = request["policy"].toString() == "block" ? Block : DropOldest;
+    sub.maxQueue = qMax(1, request["queue"].toInt(sub.maxQueue));
+    if (request.contains("from")) {
+        quint64 from = static_cast<quint64>(qMax<qint64>(1, request["from"].toInteger()));
+        sub.nextSequence = qMin(from, nextSequence);
+    }
+    sub.subscribed = true;
+}
+
+/**
+ * Writes the pending events of a subscriber in a single batch.
+ *
+ * A subscriber whose socket still has more than the high water mark pending
+ * is skipped until it drains. With DropOldest its backlog is then trimmed to
+ * the queue size; with Block it is kept as long as the history holds it.
+ * Events lost either way are reported with a gap line
+ * ({"gap": {"from": A, "to": B}}) so the subscriber can tell.
+ *
+ * @param sub The subscriber.
+ */
+void alertStream::deliver(subscriber &sub) {
+    // Events already gone from the history
+    if (sub.nextSequence < firstSequence) {
+        skipTo(sub, firstSequence);
+    }
+
+    // Drop the oldest events beyond the subscriber queue
+    quint64 pending = nextSequence - sub.nextSequence;
+    if (sub.policy == DropOldest && pending > quint64(sub.maxQueue)) {
+        skipTo(sub, nextSequence - sub.maxQueue);
+    }
+
+    // Slow subscriber, keep its events for the next flush
+    if (sub.socket->bytesToWrite() > writeHighWater) {
+        return;
+    }
+
+    QByteArray batch;
+    if (sub.gapFrom != 0) {
+        batch += gapLine(sub.gapFrom, sub.gapTo);
+        sub.gapFrom = 0;
+    }
+
+    // A blocked subscriber gets at most one queue worth per flush
+    quint64 end = nextSequence;
+    if (sub.policy == Block) {
+        end = qMin(end, sub.nextSequence + sub.maxQueue);
+    }
+
+    for (quint64 seq = sub.nextSequence; seq < end; seq++) {
+        batch += history[static_cast<qsizetype>(seq - firstSequence)];
+    }
+    sub.nextSequence = end;
+
+    if (!batch.isEmpty()) {
+        sub.socket->write(batch);
+    }
+}
+
+/**
+ * Moves the cursor of a subscriber forward, remembering the skipped events
+ * so that a single gap line reports them on the next write.
+ * @param sub The subscriber.
+ * @param sequence The next event to deliver.
+ */
+void alertStream::skipTo(subscriber &sub, quint64 sequence) {
+    if (sub.gapFrom == 0) {
+        sub.gapFrom = sub.nextSequence;
+    }
+    sub.gapTo = sequence - 1;
+    sub.nextSequence = sequence;
+}
+
+/**
+ * Encodes a gap notice for the events between two sequences, both included.
+ */
+QByteArray alertStream::gapLine(quint64 from, quint64 to) {
+    QJsonObject range;
+    range["from"] = static_cast<qint64>(from);
+    range["to"] = static_cast<qint64>(to);
+
+    QJsonObject line;
+    line["gap"] = range;
+    return QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n';
+}
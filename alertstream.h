@@ -0,0 +1,72 @@
+#ifndef ALERTSTREAM_H
+#define ALERTSTREAM_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonObject>
+#include <QQueue>
+#include <QList>
+#include <QTimer>
+#include <QPointer>
+
+// Class that pushes alert events to local socket subscribers, in batches and without ever blocking the publisher
+class alertStream : public QObject {
+    Q_OBJECT
+
+public:
+    // What happens when a subscriber falls behind
+    enum overflowPolicy {
+        DropOldest, // Skip the oldest events beyond the subscriber queue size
+        Block       // Hold the events (up to the history size) until the subscriber catches up
+    };
+
+    alertStream(QObject *parent = nullptr);
+
+    // Configuration
+    void configure(const QJsonObject &json);
+    bool listen(const QString &name);
+
+    // Publisher side, O(1) and never waits for the sockets
+    void publish(const QJsonObject &event);
+
+    quint64 lastSequence() const;
+
+private slots:
+    void onNewConnection();
+    void flush();
+
+private:
+    // Struct for a connected subscriber
+    struct subscriber
+    {
+        QPointer<QLocalSocket> socket;
+        bool subscribed = false;          // Until the subscription line arrives, nothing is sent
+        overflowPolicy policy = DropOldest;
+        int maxQueue = 256;
+        quint64 nextSequence = 0;         // Next event to deliver
+        quint64 gapFrom = 0;              // Events lost and not reported yet (0 when none)
+        quint64 gapTo = 0;
+    };
+
+    QLocalServer *server;
+    QTimer *flushTimer;
+    QList<subscriber> subscribers;
+
+    // Encoded events, shared by every subscriber
+    QQueue<QByteArray> history;
+    quint64 firstSequence = 1; // Sequence of history.head()
+    quint64 nextSequence = 1;  // Sequence of the next published event
+
+    // Tuning
+    int historySize = 1024;
+    qint64 writeHighWater = 256 * 1024; // Bytes pending in a socket before it is considered slow
+
+    // Private helper functions
+    void readSubscription(subscriber &sub);
+    void deliver(subscriber &sub);
+    static void skipTo(subscriber &sub, quint64 sequence);
+    static QByteArray gapLine(quint64 from, quint64 to);
+};
+
+#endif // ALERTSTREAM_H
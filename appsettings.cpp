@@ -0,0 +1,69 @@
+#include "appsettings.h"
+
+#include <QDebug>
+
+/**
+ * Loads the settings from a JSON file.
+ *
+ * The file is expected to contain a JSON object whose keys are the sections
+ * of the configuration (e.g. "snapshot"). If the file does not exist or is
+ * not valid, a warning is logged and every section keeps its defaults.
+ *
+ * @param filename The name of the file from which to load the settings.
+ */
+void appSettings::loadSettings(QString filename) {
+    QFile file(filename);
+
+    // Check if the file exists
+    if (!file.exists()) {
+        qWarning() << "El archivo de configuración no existe, usando valores por defecto:" << filename;
+        return;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "No se pudo abrir el archivo:" << filename;
+        return;
+    }
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    if (!jsonDoc.isObject()) {
+        qWarning() << "Formato de JSON inválido en:" << filename;
+        return;
+    }
+
+    root = jsonDoc.object();
+}
+
+/**
+ * Saves the settings to a JSON file.
+ * If the file cannot be opened for writing, a warning message is logged.
+ * @param filename The name of the file where the settings will be saved.
+ */
+void appSettings::saveSettings(QString filename) {
+    QFile file(filename);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        file.close();
+    } else {
+        qWarning() << "No se pudo guardar el archivo:" << filename;
+    }
+}
+
+/**
+ * Returns a section of the settings.
+ * @param name The name of the section.
+ * @return The section, or an empty object if it is not present.
+ */
+QJsonObject appSettings::section(const QString &name) const {
+    return root.value(name).toObject();
+}
+
+/**
+ * Replaces a section of the settings.
+ * @param name The name of the section.
+ * @param value The new contents of the section.
+ */
+void appSettings::setSection(const QString &name, const QJsonObject &value) {
+    root[name] = value;
+}
@@ -0,0 +1,27 @@
+#ifndef APPSETTINGS_H
+#define APPSETTINGS_H
+
+#include <QString>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+
+// Class to load and store the configuration file, organized in sections
+class appSettings {
+public:
+    // Load settings
+    void loadSettings(QString filename);
+
+    // Save settings
+    void saveSettings(QString filename);
+
+    // Section access
+    QJsonObject section(const QString &name) const;
+    void setSection(const QString &name, const QJsonObject &value);
+
+private:
+    // Container
+    QJsonObject root;
+};
+
+#endif // APPSETTINGS_H
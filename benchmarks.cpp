@@ -0,0 +1,842 @@
+#include "benchmarks.h"
+#include "snapshotwriter.h"
+#include "detectionengine.h"
+#include "detectorprofile.h"
+#include "detectionpipeline.h"
+#include "pipelinepolicies.h"
+#include "detectionfilter.h"
+#include "framepool.h"
+#include "ruletracker.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+#include <algorithm>
+#include <atomic>
+
+/**
+ * Measures the cost of every snapshot option on the sample images.
+ *
+ * Each policy (full frame or a detection-sized crop, PNG/JPEG/WebP at
+ * several levels) is applied to every image and the time to prepare and
+ * encode it in memory is measured, together with the encoded size. Disk
+ * writes are left out so the numbers only depend on the encoder.
+ *
+ * @param imageDir The directory with the sample images (e.g. data/img).
+ * @return 0 on success, 1 if no image could be loaded.
+ */
+int benchmarks::snapshotEncoders(const QString &imageDir) {
+    std::vector<cv::Mat> images = loadImages(imageDir);
+    if (images.empty()) {
+        return 1;
+    }
+
+    // Policies to compare
+    QList<snapshotWriter::policy> policies;
+    for (snapshotWriter::policy::region area : {snapshotWriter::policy::FullFrame, snapshotWriter::policy::Crop}) {
+        snapshotWriter::policy p;
+        p.area = area;
+
+        p.encoding = snapshotWriter::policy::Png;
+        for (int level : {1, 3, 9}) {
+            p.pngCompression = level;
+            policies.append(p);
+        }
+
+        for (snapshotWriter::policy::format format : {snapshotWriter::policy::Jpeg, snapshotWriter::policy::Webp}) {
+            p.encoding = format;
+            for (int quality : {95, 85, 70, 50}) {
+                p.quality = quality;
+                policies.append(p);
+            }
+        }
+    }
+
+    const int repetitions = 5;
+
+    qInfo().noquote() << QString("%1 %2 %3").arg("policy", -16).arg("ms/frame", 10).arg("bytes/frame", 12);
+
+    for (const snapshotWriter::policy &p : policies) {
+        snapshotWriter writer;
+        writer.setPolicy(p);
+
+        qint64 totalNs = 0;
+        qint64 totalBytes = 0;
+        int encoded = 0;
+        bool supported = true;
+
+        for (const cv::Mat &bgr : images) {
+            // The pipeline hands RGB frames to the writer, and crops around a detection
+            cv::Mat rgb;
+            cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
+            cv::Rect detection(rgb.cols / 3, rgb.rows / 4, rgb.cols / 4, rgb.rows / 3);
+
+            for (int r = 0; r < repetitions && supported; r++) {
+                std::vector<uchar> buffer;
+                QElapsedTimer timer;
+                timer.start();
+
+                cv::Mat image;
+                writer.prepare(rgb, detection, image);
+                supported = writer.encode(image, buffer);
+
+                totalNs += timer.nsecsElapsed();
+                totalBytes += static_cast<qint64>(buffer.size());
+                encoded++;
+            }
+        }
+
+        if (!supported || encoded == 0) {
+            qInfo().noquote() << QString("%1 %2").arg(p.name(), -16).arg("no soportado", 10);
+            continue;
+        }
+
+        qInfo().noquote() << QString("%1 %2 %3")
+                                 .arg(p.name(), -16)
+                                 .arg(totalNs / 1e6 / encoded, 10, 'f', 2)
+                                 .arg(totalBytes / encoded, 12);
+    }
+
+    return 0;
+}
+
+/**
+ * Sweeps the detector parameters over an image set.
+ *
+ * Every combination of the grid (scaleFactor, minNeighbors and minSize for
+ * the face cascade; winStride, padding and scale for HOG) runs on every image
+ * through the same code path as the engine, and its latency, throughput and
+ * detections per frame are measured. Without labels only this timing is
+ * reported, for both detectors, fastest first.
+ *
+ * With a labels file, only the labeled images and the detector it names are
+ * swept. A detection is a true positive when its IoU with a not yet matched
+ * label is at least 0.5. The profiles that no other profile beats in latency,
+ * precision and recall at once (the Pareto front) are printed, fastest first,
+ * with the fastest one that keeps the recall of the defaults suggested. The
+ * labels must be drawn independently on clean frames: boxes taken from the
+ * detector output (as the red boxes of the snapshots in data/img) only
+ * measure agreement with the detector itself.
+ *
+ * @param imageDir The directory with the images (e.g. data/img).
+ * @param annotationsFile The labels, {"detector": ..., "images": {"file": [[x, y, w, h], ...]}}, or empty.
+ * @param outputFile The JSON file for the results, or empty.
+ * @return 0 on success, 1 if the images or labels could not be loaded.
+ */
+int benchmarks::detectorSweep(const QString &imageDir, const QString &annotationsFile, const QString &outputFile) {
+    const bool labeled = !annotationsFile.isEmpty();
+
+    // The engine detects on RGB frames
+    bool pedestrian = false;
+    std::vector<cv::Mat> images;
+    std::vector<std::vector<cv::Rect>> truths;
+    if (labeled) {
+        QHash<QString, std::vector<cv::Rect>> labels;
+        if (!loadAnnotations(annotationsFile, pedestrian, labels)) {
+            return 1;
+        }
+        for (auto it = labels.cbegin(); it != labels.cend(); ++it) {
+            cv::Mat image = cv::imread(QDir(imageDir).filePath(it.key()).toStdString(), cv::IMREAD_COLOR);
+            if (image.empty()) {
+                qWarning() << "No se pudo leer la imagen anotada:" << it.key();
+                continue;
+            }
+            cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+            images.push_back(image);
+            truths.push_back(it.value());
+        }
+    } else {
+        images = loadImages(imageDir);
+        for (cv::Mat &image : images) {
+            cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+        }
+    }
+    if (images.empty()) {
+        qWarning() << "No se encontraron imágenes en:" << imageDir;
+        return 1;
+    }
+
+    // Parameter grid, of the labeled detector or of both
+    QList<detectorProfile> profiles;
+    for (bool hog : {false, true}) {
+        if (labeled && hog != pedestrian) {
+            continue;
+        }
+
+        detectorProfile p;
+        p.pedestrian = hog;
+        if (hog) {
+            for (int winStride : {4, 8, 16}) {
+                for (int padding : {0, 8, 16}) {
+                    for (double hogScale : {1.03, 1.05, 1.1, 1.2}) {
+                        p.winStride = winStride;
+                        p.padding = padding;
+                        p.hogScale = hogScale;
+                        profiles.append(p);
+                    }
+                }
+            }
+        } else {
+            for (double scaleFactor : {1.05, 1.1, 1.2, 1.3}) {
+                for (int minNeighbors : {2, 3, 5, 7}) {
+                    for (int minSize : {60, 90, 125, 160}) {
+                        p.scaleFactor = scaleFactor;
+                        p.minNeighbors = minNeighbors;
+                        p.minSize = minSize;
+                        profiles.append(p);
+                    }
+                }
+            }
+        }
+    }
+
+    // Struct for the measures of a profile (precision and recall only with labels)
+    struct measure
+    {
+        detectorProfile profile;
+        double msPerFrame;
+        double detectionsPerFrame;
+        double precision;
+        double recall;
+    };
+    QList<measure> measures;
+
+    manualClock clock(QDateTime::currentDateTime());
+    alertedObjects alerts;
+
+    for (const detectorProfile &profile : profiles) {
+        detectionEngine engine(&clock, &alerts);
+        engine.loadDetector(profile);
+
+        int truePositives = 0, falsePositives = 0, falseNegatives = 0;
+        qint64 detected = 0;
+        qint64 totalNs = 0;
+
+        for (size_t i = 0; i < images.size(); i++) {
+            std::vector<cv::Rect> detections;
+            QElapsedTimer timer;
+            timer.start();
+            engine.detectObjects(-1, images[i], detections);
+            totalNs += timer.nsecsElapsed();
+            detected += static_cast<qint64>(detections.size());
+
+            if (!labeled) {
+                continue;
+            }
+
+            // Greedy matching against the labels
+            std::vector<bool> matched(truths[i].size(), false);
+            for (const cv::Rect &detection : detections) {
+                int best = -1;
+                double bestIou = 0.5;
+                for (size_t t = 0; t < truths[i].size(); t++) {
+                    double iou = detectionFilter::intersectionOverUnion(detection, truths[i][t]);
+                    if (!matched[t] && iou >= bestIou) {
+                        best = static_cast<int>(t);
+                        bestIou = iou;
+                    }
+                }
+                if (best >= 0) {
+                    matched[best] = true;
+                    truePositives++;
+                } else {
+                    falsePositives++;
+                }
+            }
+            falseNegatives += static_cast<int>(std::count(matched.begin(), matched.end(), false));
+        }
+
+        measure m;
+        m.profile = profile;
+        m.msPerFrame = totalNs / 1e6 / images.size();
+        m.detectionsPerFrame = double(detected) / images.size();
+        m.precision = truePositives + falsePositives > 0 ? double(truePositives) / (truePositives + falsePositives) : 1.0;
+        m.recall = truePositives + falseNegatives > 0 ? double(truePositives) / (truePositives + falseNegatives) : 1.0;
+        measures.append(m);
+    }
+
+    auto fastestFirst = [](const measure &a, const measure &b) {
+        return a.msPerFrame < b.msPerFrame;
+    };
+
+    // Timing only: every profile, without suggestion
+    if (!labeled) {
+        std::sort(measures.begin(), measures.end(), fastestFirst);
+
+        qInfo().noquote() << QString("%1 profiles on %2 images, without labels (timing only):").arg(measures.size()).arg(images.size());
+        qInfo().noquote() << QString("%1 %2 %3 %4").arg("profile", -40).arg("ms/frame", 9).arg("fps", 7).arg("det/frame", 9);
+        QJsonArray timingsJson;
+        for (const measure &m : measures) {
+            qInfo().noquote() << QString("%1 %2 %3 %4")
+                                     .arg(m.profile.name(), -40)
+                                     .arg(m.msPerFrame, 9, 'f', 2)
+                                     .arg(m.msPerFrame > 0 ? 1000.0 / m.msPerFrame : 0.0, 7, 'f', 1)
+                                     .arg(m.detectionsPerFrame, 9, 'f', 2);
+
+            QJsonObject entry;
+            entry["profile"] = m.profile.toJson();
+            entry["msPerFrame"] = m.msPerFrame;
+            entry["detectionsPerFrame"] = m.detectionsPerFrame;
+            timingsJson.append(entry);
+        }
+
+        if (!outputFile.isEmpty()) {
+            QJsonObject result;
+            result["timings"] = timingsJson;
+            writeJson(outputFile, result);
+        }
+        return 0;
+    }
+
+    // Pareto front: nobody is at least as good in everything and better in something
+    QList<measure> front;
+    for (const measure &a : measures) {
+        bool dominated = false;
+        for (const measure &b : measures) {
+            bool noWorse = b.msPerFrame <= a.msPerFrame && b.precision >= a.precision && b.recall >= a.recall;
+            bool better = b.msPerFrame < a.msPerFrame || b.precision > a.precision || b.recall > a.recall;
+            if (noWorse && better) {
+                dominated = true;
+                break;
+            }
+        }
+        if (!dominated) {
+            front.append(a);
+        }
+    }
+    std::sort(front.begin(), front.end(), fastestFirst);
+
+    // Suggest the fastest profile that keeps the recall of the current defaults
+    detectorProfile defaults;
+    defaults.pedestrian = pedestrian;
+    double defaultRecall = 0;
+    for (const measure &m : measures) {
+        if (m.profile.toJson() == defaults.toJson()) {
+            defaultRecall = m.recall;
+        }
+    }
+    const measure *suggested = nullptr;
+    for (const measure &m : front) {
+        if (m.recall >= defaultRecall) {
+            suggested = &m;
+            break;
+        }
+    }
+
+    qInfo().noquote() << QString("%1 profiles on %2 images, Pareto front:").arg(measures.size()).arg(images.size());
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5").arg("profile", -40).arg("ms/frame", 9).arg("fps", 7).arg("precision", 9).arg("recall", 7);
+    for (const measure &m : front) {
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5%6")
+                                 .arg(m.profile.name(), -40)
+                                 .arg(m.msPerFrame, 9, 'f', 2)
+                                 .arg(m.msPerFrame > 0 ? 1000.0 / m.msPerFrame : 0.0, 7, 'f', 1)
+                                 .arg(m.precision, 9, 'f', 3)
+                                 .arg(m.recall, 7, 'f', 3)
+                                 .arg(&m == suggested ? "  <- sugerido" : "");
+    }
+
+    if (!outputFile.isEmpty()) {
+        QJsonArray frontJson;
+        for (const measure &m : front) {
+            QJsonObject entry;
+            entry["profile"] = m.profile.toJson();
+            entry["msPerFrame"] = m.msPerFrame;
+            entry["precision"] = m.precision;
+            entry["recall"] = m.recall;
+            frontJson.append(entry);
+        }
+
+        QJsonObject result;
+        result["pareto"] = frontJson;
+        if (suggested) {
+            result["detectorProfile"] = suggested->profile.toJson();
+        }
+        writeJson(outputFile, result);
+    }
+
+    return 0;
+}
+
+// Detector policy that returns the detections precomputed for each image, so only the pipeline is measured
+class replayDetector
+{
+public:
+    replayDetector(const std::vector<std::vector<cv::Rect>> *boxes, const std::vector<std::vector<double>> *weights)
+        : boxes(boxes), weights(weights) {}
+
+    void select(size_t image) { current = image; }
+
+    void detect(const cv::Mat &, std::vector<cv::Rect> &detections, std::vector<double> &scores, double) {
+        detections = (*boxes)[current];
+        scores = (*weights)[current];
+    }
+
+private:
+    const std::vector<std::vector<cv::Rect>> *boxes;
+    const std::vector<std::vector<double>> *weights;
+    size_t current = 0;
+};
+
+// Sink policy that only reports the alert, without snapshots nor alert records
+class discardSink
+{
+public:
+    void onAlert(int, const QString &id, const cv::Mat &, const cv::Rect &, qint64, const QDateTime &, frameResult &result) {
+        result.alertId = id;
+    }
+};
+
+/**
+ * Measures the per-frame cost of the pipeline glue apart from the detector.
+ *
+ * The face cascade first runs alone on every sample image, and its detections
+ * are kept. Then the same frames go through the full pipeline, and through a
+ * pipeline whose detector replays the kept detections, so the second one only
+ * measures the color conversion, filter, drawing, tracking and alert logic
+ * around the detector, together with the detections per frame before and
+ * after the filter. Frames are fed 33 ms apart so the tracker and the
+ * cooldowns behave as with a live camera; copying the frames back to BGR is not timed.
+ *
+ * @param imageDir The directory with the sample images (e.g. data/img).
+ * @return 0 on success, 1 if no image could be loaded.
+ */
+int benchmarks::pipelineOverhead(const QString &imageDir) {
+    std::vector<cv::Mat> images = loadImages(imageDir);
+    if (images.empty()) {
+        return 1;
+    }
+
+    const int repetitions = 5;
+    detectorProfile profile;
+
+    // Detector alone, on the RGB frames the pipeline would give it
+    haarDetector detector;
+    if (!detector.load(profile)) {
+        return 1;
+    }
+    std::vector<std::vector<cv::Rect>> boxes(images.size());
+    std::vector<std::vector<double>> weights(images.size());
+    qint64 detectorNs = 0;
+    for (int r = 0; r < repetitions; r++) {
+        for (size_t i = 0; i < images.size(); i++) {
+            cv::Mat rgb;
+            cv::cvtColor(images[i], rgb, cv::COLOR_BGR2RGB);
+
+            QElapsedTimer timer;
+            timer.start();
+            detector.detect(rgb, boxes[i], weights[i], 1.0);
+            detectorNs += timer.nsecsElapsed();
+        }
+    }
+
+    manualClock clock(QDateTime::currentDateTime());
+
+    // Struct for the totals of a run
+    struct runStats
+    {
+        qint64 totalNs;
+        int alerts;
+        qint64 raw;
+        qint64 kept;
+    };
+
+    // Feeds every image through a pipeline and returns the time spent in process()
+    auto run = [&](pipelineBase &pipeline, auto &&beforeFrame) {
+        pipeline.setCameraCount(1, 0);
+        timedFrame frame(0, 0, cv::Mat());
+        cv::Mat buffer;
+        qint64 totalNs = 0;
+        int alerts = 0;
+        qint64 raw = 0;
+        qint64 kept = 0;
+
+        for (int r = 0; r < repetitions; r++) {
+            for (size_t i = 0; i < images.size(); i++) {
+                images[i].copyTo(buffer);
+                frame.image = buffer;
+                frame.timestampMs += 33;
+                beforeFrame(i);
+
+                QElapsedTimer timer;
+                timer.start();
+                frameResult result = pipeline.process(frame, clock.wallTime(frame.timestampMs), nullptr, 1.0, true);
+                pipeline.endTick(frame.timestampMs);
+                totalNs += timer.nsecsElapsed();
+
+                alerts += result.alertId.isEmpty() ? 0 : 1;
+                raw += result.rawDetections;
+                kept += static_cast<qint64>(result.detections.size());
+            }
+        }
+        return runStats{totalNs, alerts, raw, kept};
+    };
+
+    detectionPipeline<haarDetector, ruleTracker, discardSink> full{detector, ruleTracker(), discardSink()};
+    auto fullRun = run(full, [](size_t) {});
+
+    detectionPipeline<replayDetector, ruleTracker, discardSink> glue{replayDetector(&boxes, &weights), ruleTracker(), discardSink()};
+    auto glueRun = run(glue, [&](size_t i) { glue.getDetector().select(i); });
+
+    const double frames = double(images.size()) * repetitions;
+    const double detectorMs = detectorNs / 1e6 / frames;
+    const double fullMs = fullRun.totalNs / 1e6 / frames;
+    const double glueMs = glueRun.totalNs / 1e6 / frames;
+
+    qInfo().noquote() << QString("%1 frames (%2 images x %3), detector %4").arg(frames).arg(images.size()).arg(repetitions).arg(profile.name());
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5").arg("stage", -20).arg("ms/frame", 10).arg("alerts", 7).arg("raw/frame", 10).arg("kept/frame", 10);
+    qInfo().noquote() << QString("%1 %2").arg("detector", -20).arg(detectorMs, 10, 'f', 3);
+    for (const auto &row : {std::make_pair(QString("pipeline"), fullRun), std::make_pair(QString("pipeline glue"), glueRun)}) {
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5")
+                                 .arg(row.first, -20)
+                                 .arg(row.second.totalNs / 1e6 / frames, 10, 'f', 3)
+                                 .arg(row.second.alerts, 7)
+                                 .arg(row.second.raw / frames, 10, 'f', 2)
+                                 .arg(row.second.kept / frames, 10, 'f', 2);
+    }
+    qInfo().noquote() << QString("glue: %1% of the pipeline").arg(fullMs > 0 ? 100.0 * glueMs / fullMs : 0.0, 0, 'f', 1);
+
+    return 0;
+}
+
+// Allocator that counts the cv::Mat buffers created while it is the default one
+class countingAllocator : public cv::MatAllocator
+{
+public:
+    countingAllocator() : base(cv::Mat::getStdAllocator()) {}
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        if (!data) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        return base->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(cv::UMatData *data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return base->allocate(data, accessFlags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData *data) const override {
+        base->deallocate(data);
+    }
+
+    qint64 count() const { return allocations.load(std::memory_order_relaxed); }
+
+private:
+    cv::MatAllocator *base;
+    mutable std::atomic<qint64> allocations{0};
+};
+
+/**
+ * Counts the cv::Mat allocations per frame of the frame loop, with and without
+ * the frame pool, and fails if the pooled loop allocates once it is warm.
+ *
+ * Each sample image stands for a camera (up to four). Every tick reads each
+ * camera into a buffer of its pool (copyTo in place of VideoCapture::read),
+ * runs the pipeline with the detections of the face cascade replayed, scales
+ * the frame for display into a kept buffer and holds the handle until the next
+ * tick, as a display or a queued consumer would. The unpooled run does the same
+ * with a new cv::Mat per frame, as the loop did before the pool. The detector
+ * and the snapshot encoding (only on alerts) allocate on their own and are left
+ * out; the detector allocations are reported apart. Only cv::Mat buffers are
+ * counted: the QPixmap the window creates from the scaled buffer for its label
+ * (one per displayed frame, in process and in viewer mode) is not, and is
+ * reported as excluded.
+ *
+ * @param imageDir The directory with the sample images (e.g. data/img).
+ * @return 0 if the pooled loop makes no cv::Mat allocation in steady state, 1 otherwise.
+ */
+int benchmarks::frameAllocations(const QString &imageDir) {
+    std::vector<cv::Mat> images = loadImages(imageDir);
+    if (images.empty()) {
+        return 1;
+    }
+    const int cameras = static_cast<int>(qMin<size_t>(4, images.size()));
+    const int warmupTicks = 10;
+    const int measuredTicks = 200;
+    const cv::Size labelSize(480, 270);
+
+    cv::MatAllocator *previousAllocator = cv::Mat::getDefaultAllocator();
+    countingAllocator counter;
+
+    // Detections of each camera, and what the detector allocates to find them
+    haarDetector detector;
+    if (!detector.load(detectorProfile())) {
+        return 1;
+    }
+    std::vector<std::vector<cv::Rect>> boxes(cameras);
+    std::vector<std::vector<double>> weights(cameras);
+    std::vector<cv::Mat> rgbImages(cameras);
+    for (int c = 0; c < cameras; c++) {
+        cv::cvtColor(images[c], rgbImages[c], cv::COLOR_BGR2RGB);
+    }
+    cv::Mat::setDefaultAllocator(&counter);
+    for (int c = 0; c < cameras; c++) {
+        detector.detect(rgbImages[c], boxes[c], weights[c], 1.0);
+    }
+    const double detectorAllocations = double(counter.count()) / cameras;
+    cv::Mat::setDefaultAllocator(previousAllocator);
+
+    manualClock clock(QDateTime::currentDateTime());
+
+    // Runs the loop and returns the allocations per frame after the warmup
+    auto run = [&](bool pooled) {
+        detectionPipeline<replayDetector, ruleTracker, discardSink> pipeline{
+            replayDetector(&boxes, &weights), ruleTracker(), discardSink()};
+        pipeline.setCameraCount(cameras, 0);
+        framePool pool;
+        pool.setCameraCount(cameras);
+        std::vector<framePool::handle> held(cameras);
+        std::vector<cv::Mat> display(cameras);
+
+        cv::Mat::setDefaultAllocator(&counter);
+        qint64 atWarmup = 0;
+        qint64 timestampMs = 0;
+
+        for (int tick = 0; tick < warmupTicks + measuredTicks; tick++) {
+            if (tick == warmupTicks) {
+                atWarmup = counter.count();
+            }
+            timestampMs += 33;
+
+            for (int c = 0; c < cameras; c++) {
+                pipeline.getDetector().select(c);
+
+                if (pooled) {
+                    framePool::handle buffer = pool.acquire(c);
+                    images[c].copyTo(buffer.capture());
+                    buffer.frame().create(buffer.capture().size(), buffer.capture().type());
+
+                    timedFrame input(c, timestampMs, buffer.capture(), buffer.frame());
+                    pipeline.process(input, clock.wallTime(timestampMs), nullptr, 1.0, true);
+                    framePool::fitFrame(buffer.frame(), labelSize, display[c]);
+                    held[c] = buffer;
+                } else {
+                    cv::Mat frame;
+                    images[c].copyTo(frame);
+
+                    timedFrame input(c, timestampMs, frame);
+                    pipeline.process(input, clock.wallTime(timestampMs), nullptr, 1.0, true);
+                    cv::Mat scaled;
+                    framePool::fitFrame(input.image, labelSize, scaled);
+                }
+            }
+            pipeline.endTick(timestampMs);
+        }
+
+        double perFrame = double(counter.count() - atWarmup) / (double(measuredTicks) * cameras);
+        cv::Mat::setDefaultAllocator(previousAllocator);
+
+        int buffers = 0;
+        for (int c = 0; c < cameras; c++) {
+            buffers += pool.bufferCount(c);
+        }
+        return std::make_pair(perFrame, buffers);
+    };
+
+    auto unpooled = run(false);
+    auto pooled = run(true);
+
+    qInfo().noquote() << QString("%1 cameras, %2 ticks after %3 of warmup").arg(cameras).arg(measuredTicks).arg(warmupTicks);
+    qInfo().noquote() << QString("%1 %2 %3").arg("loop", -12).arg("allocs/frame", 13).arg("buffers", 8);
+    qInfo().noquote() << QString("%1 %2").arg("sin pool", -12).arg(unpooled.first, 13, 'f', 2);
+    qInfo().noquote() << QString("%1 %2 %3").arg("con pool", -12).arg(pooled.first, 13, 'f', 2).arg(pooled.second, 8);
+    qInfo().noquote() << QString("detector (aparte): %1 allocs/frame").arg(detectorAllocations, 0, 'f', 1);
+    qInfo().noquote() << "visualización (excluida): 1 QPixmap por cuadro mostrado, fuera de cv::Mat";
+
+    if (pooled.first > 0) {
+        qWarning() << "El ciclo con pool sigue reservando cuadros en estado estable:" << pooled.first << "por cuadro";
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Measures the per-tick cost of the tracker and its alert rules with thousands
+ * of synthetic objects, and fails if it does not fit in the budget.
+ *
+ * The objects stand on a grid spread over four cameras, with a few pixels of
+ * jitter per frame. Each one leaves the scene for longer than the expiry once
+ * per cycle, at a different phase, so every tick also starts and drops tracks.
+ * Besides the default dwell rule, a zone rule (left half of the frame) and a
+ * rule that needs ten objects dwelling at once are evaluated. Ticks are 33 ms
+ * apart and each one feeds every object of every camera, then expires.
+ *
+ * @return 0 if the 99th percentile of every run fits in the budget, 1 otherwise.
+ */
+int benchmarks::ruleEvaluation() {
+    const int cameras = 4;
+    const int ticks = 900; // 30 seconds
+    const int cycleTicks = 600;
+    const int absentTicks = 220; // Longer than the expiry
+    const double budgetMs = 5.0;  // A sixth of a 30 fps tick
+    const cv::Size frameSize(20000, 20000); // Room for every object apart from the others
+    const int spacing = 160;
+
+    ruleTracker::rule zoneRule;
+    zoneRule.name = "zona";
+    zoneRule.zone = 0;
+    zoneRule.dwellS = 5;
+    ruleTracker::rule groupRule;
+    groupRule.name = "grupo";
+    groupRule.dwellS = 3;
+    groupRule.count = 10;
+    ruleTracker::policy rules;
+    rules.defaults = {ruleTracker::rule(), zoneRule, groupRule};
+
+    regionOfInterest region;
+    region.addPolygon({{0.0f, 0.0f}, {0.5f, 0.0f}, {0.5f, 1.0f}, {0.0f, 1.0f}});
+
+    manualClock clock(QDateTime::currentDateTime());
+    const int perRow = frameSize.width / spacing - 1;
+
+    qInfo().noquote() << QString("%1 cameras, %2 ticks, budget %3 ms per tick").arg(cameras).arg(ticks).arg(budgetMs);
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7")
+                             .arg("objects", 8).arg("tracks", 8).arg("ms/tick", 9).arg("p99 ms", 9)
+                             .arg("max ms", 9).arg("us/obj", 8).arg("alerts", 7);
+
+    bool fits = true;
+    for (int objects : {1000, 2000, 5000}) {
+        ruleTracker tracker;
+        tracker.setPolicy(rules);
+        tracker.setCameraCount(cameras, 0);
+
+        std::vector<qint64> tickNs;
+        tickNs.reserve(ticks);
+        qint64 updates = 0;
+        int alerts = 0;
+        int tracks = 0;
+
+        for (int tick = 0; tick < ticks; tick++) {
+            const qint64 timestampMs = (tick + 1) * 33;
+            const QTime wallTime = clock.wallTime(timestampMs).time();
+
+            QElapsedTimer timer;
+            timer.start();
+            for (int k = 0; k < objects; k++) {
+                if ((tick + k * 37) % cycleTicks >= cycleTicks - absentTicks) {
+                    continue;
+                }
+                const int slot = k / cameras;
+                const int jitter = (tick * 7 + k) % 9 - 4;
+                cv::Rect detected((slot % perRow + 1) * spacing + jitter, (slot / perRow + 1) * spacing - jitter, 64, 64);
+
+                alerts += tracker.track(k % cameras, detected, frameSize, &region, timestampMs, wallTime).alert ? 1 : 0;
+                updates++;
+            }
+            tracker.expire(timestampMs);
+            tickNs.push_back(timer.nsecsElapsed());
+            tracks = qMax(tracks, tracker.trackCount());
+        }
+
+        std::vector<qint64> sorted = tickNs;
+        std::sort(sorted.begin(), sorted.end());
+        qint64 totalNs = 0;
+        for (qint64 ns : tickNs) {
+            totalNs += ns;
+        }
+        const double meanMs = totalNs / 1e6 / ticks;
+        const double p99Ms = sorted[static_cast<size_t>(0.99 * (ticks - 1))] / 1e6;
+        const double maxMs = sorted.back() / 1e6;
+        fits = fits && p99Ms <= budgetMs;
+
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7")
+                                 .arg(objects, 8).arg(tracks, 8)
+                                 .arg(meanMs, 9, 'f', 3).arg(p99Ms, 9, 'f', 3).arg(maxMs, 9, 'f', 3)
+                                 .arg(updates > 0 ? totalNs / 1e3 / updates : 0.0, 8, 'f', 3).arg(alerts, 7);
+    }
+
+    if (!fits) {
+        qWarning() << "La evaluación de reglas supera el presupuesto de" << budgetMs << "ms por ciclo";
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Writes the results of a benchmark to a JSON file.
+ */
+void benchmarks::writeJson(const QString &filename, const QJsonObject &result) {
+    QFile file(filename);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(result).toJson(QJsonDocument::Indented));
+        file.close();
+    } else {
+        qWarning() << "No se pudo guardar el archivo:" << filename;
+    }
+}
+
+/**
+ * Lists the image files of a directory, sorted by name.
+ */
+QStringList benchmarks::listImages(const QString &imageDir) {
+    QDir dir(imageDir);
+    QStringList files = dir.entryList({"*.png", "*.jpg", "*.jpeg", "*.webp"}, QDir::Files, QDir::Name);
+    for (QString &file : files) {
+        file = dir.filePath(file);
+    }
+    return files;
+}
+
+/**
+ * Loads every image of a directory, in BGR as the cameras deliver them.
+ */
+std::vector<cv::Mat> benchmarks::loadImages(const QString &imageDir) {
+    std::vector<cv::Mat> images;
+    for (const QString &file : listImages(imageDir)) {
+        cv::Mat image = cv::imread(file.toStdString(), cv::IMREAD_COLOR);
+        if (!image.empty()) {
+            images.push_back(image);
+        }
+    }
+
+    if (images.empty()) {
+        qWarning() << "No se encontraron imágenes en:" << imageDir;
+    }
+    return images;
+}
+
+/**
+ * Loads the labels of a benchmark image set.
+ * @param filename The JSON file, {"detector": "haar" or "hog", "images": {"file": [[x, y, w, h], ...]}}.
+ * @param pedestrian Output, true if the labels are for the HOG pedestrian detector.
+ * @param boxes Output, the labeled rectangles of each image file.
+ * @return True if the file could be read and contains at least one image.
+ */
+bool benchmarks::loadAnnotations(const QString &filename, bool &pedestrian, QHash<QString, std::vector<cv::Rect>> &boxes) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "No se pudo abrir el archivo:" << filename;
+        return false;
+    }
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!jsonDoc.isObject()) {
+        qWarning() << "Formato de JSON inválido en:" << filename;
+        return false;
+    }
+
+    QJsonObject root = jsonDoc.object();
+    pedestrian = root["detector"].toString() == "hog";
+
+    QJsonObject images = root["images"].toObject();
+    for (auto it = images.constBegin(); it != images.constEnd(); ++it) {
+        std::vector<cv::Rect> rects;
+        for (const QJsonValue &value : it.value().toArray()) {
+            QJsonArray rect = value.toArray();
+            if (rect.size() == 4) {
+                rects.emplace_back(rect[0].toInt(), rect[1].toInt(), rect[2].toInt(), rect[3].toInt());
+            }
+        }
+        boxes.insert(it.key(), rects);
+    }
+
+    return !boxes.isEmpty();
+}
@@ -0,0 +1,29 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QJsonObject>
+
+#include <opencv2/opencv.hpp>
+
+// Class with the command line benchmarks, run on the sample images instead of the cameras
+class benchmarks
+{
+public:
+    static int snapshotEncoders(const QString &imageDir);
+    static int detectorSweep(const QString &imageDir, const QString &annotationsFile, const QString &outputFile);
+    static int pipelineOverhead(const QString &imageDir);
+    static int frameAllocations(const QString &imageDir);
+    static int ruleEvaluation();
+
+private:
+    // Private helper functions
+    static QStringList listImages(const QString &imageDir);
+    static std::vector<cv::Mat> loadImages(const QString &imageDir);
+    static void writeJson(const QString &filename, const QJsonObject &result);
+    static bool loadAnnotations(const QString &filename, bool &pedestrian, QHash<QString, std::vector<cv::Rect>> &boxes);
+};
+
+#endif // BENCHMARKS_H
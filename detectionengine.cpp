@@ -0,0 +1,220 @@
+#include "detectionengine.h"
+
+#include <QDebug>
+
+/**
+ * Constructor for detectionEngine.
+ * @param clock The clock that timestamps the frames, used to convert timestamps to wall time.
+ * @param alerts The container where new alerts are inserted.
+ */
+detectionEngine::detectionEngine(frameClock *clock, alertedObjects *alerts)
+    : clock(clock) {
+    context.alerts = alerts;
+}
+
+/**
+ * Loads the Haar Cascade and SVM classifier for face detection or pedestrian detection from the provided path.
+ * The parameters of the profile are used for every detection from now on, so a
+ * profile picked with the --bench-detector sweep can be loaded at runtime.
+ * The pipeline specialized for the detector is built here, once, so the frames
+ * never branch on the detector kind.
+ * @param profile The detector and its parameters.
+ * @see makePipeline
+ */
+void detectionEngine::loadDetector(const detectorProfile &profile) {
+    this->profile = profile;
+    qDebug() << "Loading detector:" << profile.name();
+
+    pipeline = makePipeline(profile, &context);
+    pipeline->setRulePolicy(rulePolicy);
+    pipeline->setCameraCount(cameraCount, clock->nowMs());
+    pipeline->setFilterPolicy(filterPolicy);
+}
+
+/**
+ * Resets the per-camera alert state for the given number of cameras.
+ * The timestamp is passed in, rather than read from the clock, so that the
+ * live run and its replay start the cooldowns at the same time.
+ * @param count The number of cameras.
+ * @param timestampMs The timestamp from which the cooldowns start.
+ */
+void detectionEngine::setCameraCount(int count, qint64 timestampMs) {
+    cameraCount = count;
+    if (pipeline) {
+        pipeline->setCameraCount(count, timestampMs);
+    }
+}
+
+/**
+ * Enables or disables writing snapshot images when an alert is raised.
+ * Replays disable it so that only the alert records are compared.
+ * @param save True to write snapshots to data/img.
+ */
+void detectionEngine::setSaveSnapshots(bool save) {
+    context.saveSnapshots = save;
+}
+
+/**
+ * Sets how the alert snapshots are cropped and encoded.
+ * @param policy The snapshot policy, usually read from the "snapshot" section of the settings.
+ */
+void detectionEngine::setSnapshotPolicy(const snapshotWriter::policy &policy) {
+    context.writer.setPolicy(policy);
+}
+
+/**
+ * Sets how the redundant detections are removed before tracking.
+ * @param policy The filter policy, usually read from the "nms" section of the settings.
+ */
+void detectionEngine::setFilterPolicy(const detectionFilter::policy &policy) {
+    filterPolicy = policy;
+    if (pipeline) {
+        pipeline->setFilterPolicy(policy);
+    }
+}
+
+/**
+ * Sets the alert rules and the tracking options. The tracked objects are dropped.
+ * @param policy The rule policy, usually read from the "rules" section of the settings.
+ */
+void detectionEngine::setRulePolicy(const ruleTracker::policy &policy) {
+    rulePolicy = policy;
+    if (pipeline) {
+        pipeline->setRulePolicy(policy);
+    }
+}
+
+/**
+ * Sets the region of interest of a camera. An empty region scans the whole frame.
+ * @param camera The index of the camera.
+ * @param region The polygons where detection runs.
+ */
+void detectionEngine::setRegion(int camera, const regionOfInterest &region) {
+    regions[camera] = region;
+}
+
+/**
+ * Returns the region of interest of a camera (empty if none was set), without
+ * copying it, since the display reads it for every frame. The reference is
+ * valid until the regions change.
+ * @param camera The index of the camera.
+ */
+const regionOfInterest &detectionEngine::getRegion(int camera) const {
+    static const regionOfInterest none;
+    auto it = regions.constFind(camera);
+    return it == regions.constEnd() ? none : it.value();
+}
+
+/**
+ * Applies the settings that affect the results of the engine: the "snapshot",
+ * "nms" and "rules" policies and the "cameras" section, where each camera
+ * index maps to an object with its "roi" polygons (the zones of the rules)
+ * and its own "rules". Replays apply the settings stored in the recording so
+ * they see the same configuration as the live run.
+ *
+ * @param settings The loaded settings.
+ */
+void detectionEngine::configure(const appSettings &settings) {
+    setSnapshotPolicy(snapshotWriter::policy::fromJson(settings.section("snapshot")));
+    setFilterPolicy(detectionFilter::policy::fromJson(settings.section("nms")));
+
+    const QJsonObject cameras = settings.section("cameras");
+    setRulePolicy(ruleTracker::policy::fromJson(settings.section("rules"), cameras));
+    setRegions(cameras);
+}
+
+/**
+ * Replaces the regions of interest of every camera with the "roi" polygons of
+ * the "cameras" section, and the id of their next polygon ("nextZoneId").
+ * Unlike configure, the tracked objects are kept, so a replay can apply the
+ * region changes of the live run at the tick they happened.
+ * @param cameras The "cameras" section of the settings.
+ */
+void detectionEngine::setRegions(const QJsonObject &cameras) {
+    regions.clear();
+    for (auto it = cameras.constBegin(); it != cameras.constEnd(); ++it) {
+        bool ok = false;
+        int camera = it.key().toInt(&ok);
+        if (ok) {
+            const QJsonObject entry = it.value().toObject();
+            regionOfInterest region = regionOfInterest::fromJson(entry["roi"].toArray());
+            region.setNextId(entry["nextZoneId"].toInt());
+            setRegion(camera, region);
+        }
+    }
+}
+
+/**
+ * Processes a frame: converts it to RGB, performs object detection and updates
+ * the tracked objects and the alert state of its camera, through the pipeline
+ * of the loaded detector.
+ *
+ * @param input The frame to process, converted to RGB into its rgb buffer, which becomes its image.
+ * @param detectionScale The factor applied to the frame size before detection.
+ * @param detect False to skip the detector for this frame.
+ * @return The detections, the alert level of the camera, the id of the new alert, if any,
+ * and the fraction of the frame scanned by the detector.
+ * @see detectionPipeline::process
+ */
+detectionEngine::frameResult detectionEngine::processFrame(timedFrame &input, double detectionScale, bool detect) {
+    if (!pipeline) {
+        return frameResult();
+    }
+    return pipeline->process(input, clock->wallTime(input.timestampMs), regionOf(input.camera), detectionScale, detect);
+}
+
+/**
+ * Closes a tick of the frame loop, removing the objects that are no longer tracked.
+ * @param timestampMs The timestamp of the tick.
+ * @see ruleTracker::expire
+ */
+void detectionEngine::endTick(qint64 timestampMs) {
+    if (pipeline) {
+        pipeline->endTick(timestampMs);
+    }
+}
+
+/**
+ * Returns the clock used by the engine.
+ */
+frameClock *detectionEngine::getClock() {
+    return clock;
+}
+
+/**
+ * Checks if the engine uses the HOG pedestrian detector instead of the face cascade.
+ */
+bool detectionEngine::isUsingHog() const {
+    return profile.pedestrian;
+}
+
+/**
+ * Runs the configured detector on the regions of interest of a camera.
+ * The detector only sees the bounding crops of the polygons; the results are
+ * mapped back to frame coordinates and those whose center falls outside the
+ * polygons are discarded. The redundant detections are then removed by the filter.
+ *
+ * @param camera The index of the camera.
+ * @param frame The frame to run the detector on.
+ * @param detections The output vector of detected rectangles, in frame coordinates.
+ * @param scale The factor applied to the frame size before detection.
+ * @return The number of detections before the filter.
+ */
+int detectionEngine::detectObjects(int camera, const cv::Mat &frame, std::vector<cv::Rect> &detections, double scale) {
+    if (!pipeline) {
+        return 0;
+    }
+    return pipeline->detect(frame, regionOf(camera), detections, scale);
+}
+
+/**
+ * Returns the region of interest of a camera, or nullptr if it scans the whole frame.
+ * @param camera The index of the camera.
+ */
+const regionOfInterest *detectionEngine::regionOf(int camera) const {
+    auto it = regions.constFind(camera);
+    if (it == regions.constEnd() || it->isEmpty()) {
+        return nullptr;
+    }
+    return &it.value();
+}
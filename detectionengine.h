@@ -0,0 +1,70 @@
+#ifndef DETECTIONENGINE_H
+#define DETECTIONENGINE_H
+
+#include "frameclock.h"
+#include "alertedobjects.h"
+#include "snapshotwriter.h"
+#include "regionofinterest.h"
+#include "appsettings.h"
+#include "detectorprofile.h"
+#include "detectionpipeline.h"
+#include "pipelinepolicies.h"
+
+#include <QHash>
+#include <QString>
+
+#include <opencv2/opencv.hpp>
+
+// Class that runs detection, tracking and alerting on timestamped frames, independent of the UI
+class detectionEngine
+{
+public:
+    using timedFrame = ::timedFrame;
+    using frameResult = ::frameResult;
+
+    detectionEngine(frameClock *clock, alertedObjects *alerts);
+
+    // Configuration
+    void loadDetector(const detectorProfile &profile);
+    void setCameraCount(int count, qint64 timestampMs);
+    void setSaveSnapshots(bool save);
+    void setSnapshotPolicy(const snapshotWriter::policy &policy);
+    void setFilterPolicy(const detectionFilter::policy &policy);
+    void setRulePolicy(const ruleTracker::policy &policy);
+    void setRegion(int camera, const regionOfInterest &region);
+    void setRegions(const QJsonObject &cameras);
+    const regionOfInterest &getRegion(int camera) const;
+    void configure(const appSettings &settings);
+
+    // Main functions
+    frameResult processFrame(timedFrame &input, double detectionScale = 1.0, bool detect = true);
+    void endTick(qint64 timestampMs);
+
+    // Detector only, also used by the benchmarks
+    int detectObjects(int camera, const cv::Mat &frame, std::vector<cv::Rect> &detections, double scale = 1.0);
+
+    frameClock *getClock();
+    bool isUsingHog() const;
+
+private:
+    frameClock *clock;
+
+    // Alert state shared by the sinks of the pipeline
+    alertContext context;
+
+    // Pipeline built for the loaded detector, see makePipeline
+    std::unique_ptr<pipelineBase> pipeline;
+    int cameraCount = 0;
+
+    // Regions of interest per camera (cameras without one scan the whole frame)
+    QHash<int, regionOfInterest> regions;
+
+    detectorProfile profile;
+    detectionFilter::policy filterPolicy;
+    ruleTracker::policy rulePolicy;
+
+    // Private helper functions
+    const regionOfInterest *regionOf(int camera) const;
+};
+
+#endif // DETECTIONENGINE_H
@@ -0,0 +1,137 @@
+#include "detectionfilter.h"
+
+#include <algorithm>
+
+/**
+ * Builds a policy from its JSON representation (the "nms" section of the settings).
+ * Missing values keep the defaults.
+ * @param json The JSON object.
+ * @return The policy.
+ */
+detectionFilter::policy detectionFilter::policy::fromJson(const QJsonObject &json) {
+    policy p;
+
+    p.enabled = json["enabled"].toBool(p.enabled);
+    p.iouThreshold = qBound(0.0, json["iouThreshold"].toDouble(p.iouThreshold), 1.0);
+    p.mergeNested = json["mergeNested"].toBool(p.mergeNested);
+    p.containment = qBound(0.0, json["containment"].toDouble(p.containment), 1.0);
+    return p;
+}
+
+/**
+ * Converts the policy to its JSON representation.
+ */
+QJsonObject detectionFilter::policy::toJson() const {
+    QJsonObject json;
+    json["enabled"] = enabled;
+    json["iouThreshold"] = iouThreshold;
+    json["mergeNested"] = mergeNested;
+    json["containment"] = containment;
+    return json;
+}
+
+/**
+ * Returns a short readable name for the policy.
+ */
+QString detectionFilter::policy::name() const {
+    if (!enabled) {
+        return "nms off";
+    }
+    return mergeNested ? QString("nms iou=%1 nested=%2").arg(iouThreshold).arg(containment)
+                       : QString("nms iou=%1").arg(iouThreshold);
+}
+
+/**
+ * Sets the options of the filter.
+ * @param filterPolicy The policy, usually read from the "nms" section of the settings.
+ */
+void detectionFilter::setPolicy(const policy &filterPolicy) {
+    this->filterPolicy = filterPolicy;
+}
+
+/**
+ * Returns the options of the filter.
+ */
+detectionFilter::policy detectionFilter::getPolicy() const {
+    return filterPolicy;
+}
+
+/**
+ * Removes the redundant detections of a frame, in place.
+ *
+ * The boxes are visited from best to worst: by score when the detector gave
+ * one per box (HOG weights, cascade level weights), otherwise by area. A box
+ * is dropped when its IoU with an already kept box is over the threshold or,
+ * with mergeNested, when one of the two mostly contains the other. The kept
+ * boxes stay in their original order so the drawing and tracking order does
+ * not change.
+ *
+ * @param boxes The detections, replaced by the ones that survive.
+ * @param scores The confidence of each box, or empty if the detector has none.
+ */
+void detectionFilter::apply(std::vector<cv::Rect> &boxes, const std::vector<double> &scores) {
+    if (!filterPolicy.enabled || boxes.size() < 2) {
+        return;
+    }
+
+    const bool scored = scores.size() == boxes.size();
+    order.resize(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        if (scored && scores[a] != scores[b]) {
+            return scores[a] > scores[b];
+        }
+        return boxes[a].area() > boxes[b].area();
+    });
+
+    kept.clear();
+    for (int candidate : order) {
+        bool suppressed = false;
+        for (int better : kept) {
+            if (overlaps(boxes[candidate], boxes[better])) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            kept.push_back(candidate);
+        }
+    }
+
+    if (kept.size() == boxes.size()) {
+        return;
+    }
+
+    // Compact the survivors in their original order
+    std::sort(kept.begin(), kept.end());
+    for (size_t i = 0; i < kept.size(); i++) {
+        boxes[i] = boxes[kept[i]];
+    }
+    boxes.resize(kept.size());
+}
+
+/**
+ * Computes the intersection over union of two rectangles.
+ */
+double detectionFilter::intersectionOverUnion(const cv::Rect &a, const cv::Rect &b) {
+    double intersection = (a & b).area();
+    double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0 ? intersection / unionArea : 0.0;
+}
+
+/**
+ * Checks if a candidate box is redundant with a better box already kept.
+ */
+bool detectionFilter::overlaps(const cv::Rect &candidate, const cv::Rect &better) const {
+    if (intersectionOverUnion(candidate, better) > filterPolicy.iouThreshold) {
+        return true;
+    }
+    if (filterPolicy.mergeNested) {
+        double intersection = (candidate & better).area();
+        double smaller = std::min(candidate.area(), better.area());
+        return smaller > 0 && intersection >= filterPolicy.containment * smaller;
+    }
+    return false;
+}
@@ -0,0 +1,45 @@
+#ifndef DETECTIONFILTER_H
+#define DETECTIONFILTER_H
+
+#include <QString>
+#include <QJsonObject>
+
+#include <opencv2/opencv.hpp>
+
+// Class for the post-detection stage: non-maximum suppression and merging of nested boxes, before tracking
+class detectionFilter
+{
+public:
+    // Struct for the filter options
+    struct policy
+    {
+        bool enabled = true;
+        double iouThreshold = 0.4;  // Boxes overlapping a better one by more than this IoU are suppressed
+        bool mergeNested = true;    // Also suppress boxes mostly inside (or around) a better one
+        double containment = 0.8;   // Fraction of the smaller box that must be covered to be nested
+
+        static policy fromJson(const QJsonObject &json);
+        QJsonObject toJson() const;
+        QString name() const;
+    };
+
+    void setPolicy(const policy &filterPolicy);
+    policy getPolicy() const;
+
+    // Main functions
+    void apply(std::vector<cv::Rect> &boxes, const std::vector<double> &scores);
+
+    static double intersectionOverUnion(const cv::Rect &a, const cv::Rect &b);
+
+private:
+    policy filterPolicy;
+
+    // Scratch buffers reused between frames
+    std::vector<int> order;
+    std::vector<int> kept;
+
+    // Private helper functions
+    bool overlaps(const cv::Rect &candidate, const cv::Rect &better) const;
+};
+
+#endif // DETECTIONFILTER_H
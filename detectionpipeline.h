@@ -0,0 +1,210 @@
+#ifndef DETECTIONPIPELINE_H
+#define DETECTIONPIPELINE_H
+
+#include "regionofinterest.h"
+#include "detectionfilter.h"
+#include "ruletracker.h"
+
+#include <QDateTime>
+#include <QString>
+
+#include <opencv2/opencv.hpp>
+
+// Struct for a captured frame and the monotonic timestamp of its tick
+struct timedFrame
+{
+    int camera;
+    qint64 timestampMs;
+    cv::Mat image; // BGR as captured, RGB once processed
+    cv::Mat rgb;   // Target of the conversion; when already allocated (e.g. a pooled buffer) it is reused
+
+    timedFrame() : camera(-1), timestampMs(0) {}
+    timedFrame(int _camera, qint64 _timestampMs, const cv::Mat &_image, const cv::Mat &_rgb = cv::Mat())
+        : camera(_camera), timestampMs(_timestampMs), image(_image), rgb(_rgb) {}
+};
+
+// Struct for the outcome of processing a frame
+struct frameResult
+{
+    std::vector<cv::Rect> detections; // Detections that survived the filter
+    int rawDetections = 0;            // Detections before the filter
+    int alertLevel = 0; // 0 no detection, 1 detection, 2 alert
+    QString alertId;    // Not empty when an alert was raised (or merged) by this frame
+    bool merged = false; // True if the alert was merged into an existing one
+    double scannedFraction = 1.0; // Fraction of the frame pixels given to the detector
+};
+
+// Interface of a configured pipeline, so the engine picks its instantiation once and makes a single call per frame
+class pipelineBase
+{
+public:
+    virtual ~pipelineBase() = default;
+
+    virtual void setCameraCount(int count, qint64 timestampMs) = 0;
+    virtual void setFilterPolicy(const detectionFilter::policy &policy) = 0;
+    virtual void setRulePolicy(const ruleTracker::policy &policy) = 0;
+    virtual frameResult process(timedFrame &input, const QDateTime &wallTime, const regionOfInterest *region,
+                                double detectionScale, bool detect) = 0;
+    virtual int detect(const cv::Mat &frame, const regionOfInterest *region,
+                       std::vector<cv::Rect> &detections, double scale) = 0;
+    virtual void endTick(qint64 timestampMs) = 0;
+};
+
+/**
+ * Detection, tracking and alerting of a frame, specialized at compile time.
+ *
+ * The detections go through a detectionFilter before tracking.
+ * The policies are plain classes with inline members, so every combination
+ * is a separate instantiation without branches on the detector kind:
+ *  - Detector: void detect(const cv::Mat &input, std::vector<cv::Rect> &detections,
+ *                          std::vector<double> &scores, double scale), with empty scores if it has none
+ *  - Tracker: setCameraCount, setPolicy, clearLevel, level, expire, and
+ *             track(camera, detected, frameSize, region, timestampMs, wallTime), returning
+ *             the id of the object and whether a rule raised an alert (see ruleTracker)
+ *  - Sink: void onAlert(int camera, const QString &id, const cv::Mat &frame, const cv::Rect &detected,
+ *                       qint64 timestampMs, const QDateTime &wallTime, frameResult &result)
+ *
+ * @see pipelinepolicies.h
+ */
+template <class Detector, class Tracker, class Sink>
+class detectionPipeline final : public pipelineBase
+{
+public:
+    detectionPipeline(Detector detector, Tracker tracker, Sink sink)
+        : detector(std::move(detector)), tracker(std::move(tracker)), sink(std::move(sink)) {}
+
+    void setCameraCount(int count, qint64 timestampMs) override {
+        tracker.setCameraCount(count, timestampMs);
+    }
+
+    void setFilterPolicy(const detectionFilter::policy &policy) override {
+        filter.setPolicy(policy);
+    }
+
+    void setRulePolicy(const ruleTracker::policy &policy) override {
+        tracker.setPolicy(policy);
+    }
+
+    /**
+     * Processes a frame: converts it to RGB, runs the detector on the regions of
+     * interest, removes the redundant detections, draws a red rectangle around
+     * every remaining one and updates the tracked objects. When one of the alert
+     * rules of the camera fires on an object the sink receives the alert.
+     * Every time used here comes from the frame timestamp, so the same frames
+     * always produce the same alerts regardless of how fast they are fed.
+     *
+     * @param input The frame to process, converted to RGB into its rgb buffer, which becomes its image.
+     * @param wallTime The wall time of the frame timestamp.
+     * @param region The region of interest of the camera, or nullptr for the whole frame.
+     * @param detectionScale The factor applied to the frame size before detection.
+     * @param detect False to skip the detector for this frame.
+     */
+    frameResult process(timedFrame &input, const QDateTime &wallTime, const regionOfInterest *region,
+                        double detectionScale, bool detect) override {
+        frameResult result;
+
+        const int i = input.camera;
+
+        // Convert the frame from BGR to RGB (not in place, which would copy the source first)
+        cv::cvtColor(input.image, input.rgb, cv::COLOR_BGR2RGB);
+        input.image = input.rgb;
+        cv::Mat &frame = input.image;
+
+        // Object detection, restricted to the regions of interest of the camera
+        if (detect) {
+            result.rawDetections = this->detect(frame, region, result.detections, detectionScale);
+        }
+        result.scannedFraction = region ? region->scannedFraction(frame.size()) : 1.0;
+
+        // Draw rectangles around detected objects, and manage logic of detected objects
+        if (result.detections.empty()) {
+            tracker.clearLevel(i);
+        } else {
+            const QTime currentTime = wallTime.time();
+            for (const cv::Rect &detected : result.detections) {
+                cv::rectangle(frame, detected, cv::Scalar(255, 0, 0), 2); // Draw a red rectangle
+
+                auto tracked = tracker.track(i, detected, frame.size(), region, input.timestampMs, currentTime);
+                if (tracked.alert) {
+                    sink.onAlert(i, tracked.id, frame, detected, input.timestampMs, wallTime, result);
+                }
+            }
+        }
+
+        result.alertLevel = tracker.level(i);
+        return result;
+    }
+
+    /**
+     * Runs the detector on the bounding crops of the region polygons, or on the
+     * whole frame without a region. The results are mapped back to frame
+     * coordinates and those whose center falls outside the polygons are discarded.
+     * The remaining detections then go through the filter.
+     * @return The number of detections before the filter.
+     */
+    int detect(const cv::Mat &frame, const regionOfInterest *region,
+               std::vector<cv::Rect> &detections, double scale) override {
+        scores.clear();
+        if (!region) {
+            detectInCrop(frame, detections, scores, scale);
+        } else {
+            for (const cv::Rect &crop : region->cropRects(frame.size())) {
+                found.clear();
+                foundScores.clear();
+                detectInCrop(frame(crop), found, foundScores, scale);
+
+                const bool scored = foundScores.size() == found.size();
+                for (size_t k = 0; k < found.size(); k++) {
+                    cv::Rect rect = found[k] + crop.tl();
+                    if (region->contains(rect, frame.size())) {
+                        detections.push_back(rect);
+                        if (scored) {
+                            scores.push_back(foundScores[k]);
+                        }
+                    }
+                }
+            }
+        }
+
+        const int raw = static_cast<int>(detections.size());
+        filter.apply(detections, scores);
+        return raw;
+    }
+
+    void endTick(qint64 timestampMs) override {
+        tracker.expire(timestampMs);
+    }
+
+    Detector &getDetector() { return detector; }
+    Tracker &getTracker() { return tracker; }
+    Sink &getSink() { return sink; }
+
+private:
+    Detector detector;
+    Tracker tracker;
+    Sink sink;
+    detectionFilter filter;
+
+    // Scratch buffers reused between frames
+    std::vector<cv::Rect> found;
+    std::vector<double> scores;
+    std::vector<double> foundScores;
+    cv::Mat scaled;
+
+    // Runs the detector on a downscaled copy when the scale is lower than 1 and maps the results back
+    void detectInCrop(const cv::Mat &crop, std::vector<cv::Rect> &detections, std::vector<double> &cropScores, double scale) {
+        if (scale >= 1.0) {
+            detector.detect(crop, detections, cropScores, 1.0);
+            return;
+        }
+
+        cv::resize(crop, scaled, cv::Size(), scale, scale, cv::INTER_AREA);
+        detector.detect(scaled, detections, cropScores, scale);
+        for (cv::Rect &rect : detections) {
+            rect = cv::Rect(cvRound(rect.x / scale), cvRound(rect.y / scale),
+                            cvRound(rect.width / scale), cvRound(rect.height / scale));
+        }
+    }
+};
+
+#endif // DETECTIONPIPELINE_H
@@ -0,0 +1,45 @@
+#include "detectorprofile.h"
+
+/**
+ * Builds a profile from its JSON representation (the "detectorProfile"
+ * section of the settings). Missing values keep the historical defaults.
+ * @param json The JSON object.
+ * @return The profile.
+ */
+detectorProfile detectorProfile::fromJson(const QJsonObject &json) {
+    detectorProfile p;
+
+    p.pedestrian = json["detector"].toString() == "hog";
+    p.scaleFactor = qMax(1.01, json["scaleFactor"].toDouble(p.scaleFactor));
+    p.minNeighbors = qMax(0, json["minNeighbors"].toInt(p.minNeighbors));
+    p.minSize = qMax(0, json["minSize"].toInt(p.minSize));
+    p.winStride = qMax(0, json["winStride"].toInt(p.winStride));
+    p.padding = qMax(0, json["padding"].toInt(p.padding));
+    p.hogScale = qMax(1.01, json["hogScale"].toDouble(p.hogScale));
+    return p;
+}
+
+/**
+ * Converts the profile to its JSON representation.
+ */
+QJsonObject detectorProfile::toJson() const {
+    QJsonObject json;
+    json["detector"] = pedestrian ? "hog" : "haar";
+    json["scaleFactor"] = scaleFactor;
+    json["minNeighbors"] = minNeighbors;
+    json["minSize"] = minSize;
+    json["winStride"] = winStride;
+    json["padding"] = padding;
+    json["hogScale"] = hogScale;
+    return json;
+}
+
+/**
+ * Returns a short readable name with the parameters of the active detector.
+ */
+QString detectorProfile::name() const {
+    if (pedestrian) {
+        return QString("hog stride=%1 pad=%2 scale=%3").arg(winStride).arg(padding).arg(hogScale);
+    }
+    return QString("haar scale=%1 neighbors=%2 min=%3").arg(scaleFactor).arg(minNeighbors).arg(minSize);
+}
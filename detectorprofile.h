@@ -0,0 +1,27 @@
+#ifndef DETECTORPROFILE_H
+#define DETECTORPROFILE_H
+
+#include <QString>
+#include <QJsonObject>
+
+// Struct for the detector parameters, chosen with the --bench-detector sweep
+struct detectorProfile
+{
+    bool pedestrian = false; // HOG pedestrian detector instead of the face cascade
+
+    // Haar cascade
+    double scaleFactor = 1.1;
+    int minNeighbors = 3;
+    int minSize = 125;       // Minimum side of a detection, in pixels at full resolution
+
+    // HOG
+    int winStride = 0;       // 0 uses the OpenCV default (the block stride)
+    int padding = 0;
+    double hogScale = 1.05;
+
+    static detectorProfile fromJson(const QJsonObject &json);
+    QJsonObject toJson() const;
+    QString name() const;
+};
+
+#endif // DETECTORPROFILE_H
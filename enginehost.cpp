@@ -0,0 +1,295 @@
+#include "enginehost.h"
+
+#include <QCoreApplication>
+#include <QCameraDevice>
+#include <QMediaDevices>
+#include <QDebug>
+
+const QString engineHost::frameRingKey = "proyecto-algoritmos-frames";
+const QString engineHost::alertSocketName = "proyecto-algoritmos-alerts";
+
+/**
+ * Constructor for engineHost.
+ * Loads the settings, the detector and the stored alerts, and prepares the
+ * single shot timer of the frame loop. The cameras are opened by start().
+ * @param parent The parent QObject.
+ */
+engineHost::engineHost(QObject *parent) : QObject(parent), engine(&clock, &alerts) {
+    settings.loadSettings("../../data/config.json");
+
+    engine.loadDetector(detectorProfile::fromJson(settings.section("detectorProfile")));
+    engine.configure(settings);
+
+    alerts.loadAlerts("../../data/alerts.json");
+
+    // Publish new alerts to the local socket, in this process or as a separate engine
+    stream = new alertStream(this);
+    stream->configure(settings.section("alertStream"));
+    alerts.setStream(stream);
+
+    // Retention of old snapshots and records; the file is saved as soon as records are pruned
+    retention = new retentionManager(&alerts, "../../data/img", this);
+    retention->configure(retentionManager::policy::fromJson(settings.section("retention"), settings.section("cameras")));
+    connect(retention, &retentionManager::alertsRemoved, this, &engineHost::saveAlerts);
+    connect(retention, &retentionManager::alertsRemoved, this, &engineHost::alertsRemoved);
+
+    // Single shot timer to update frames, rescheduled by the scheduler after each tick
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, &engineHost::updateFrames);
+}
+
+/**
+ * Destructor for engineHost.
+ * Releases all camera resources.
+ */
+engineHost::~engineHost() {
+    // Release all camera resources
+    for (auto &camera : cameras) {
+        if (camera.isOpened()) {
+            camera.release();
+        }
+    }
+}
+
+/**
+ * Opens the alert socket and the cameras, and starts the frame loop and the retention passes.
+ */
+void engineHost::start() {
+    stream->listen(alertSocketName);
+    setCameras();
+    scheduler.setCameraCount(cameras.size());
+    timer->start(0);
+    retention->start();
+}
+
+/**
+ * Makes the engine available to viewers in other processes.
+ *
+ * Annotated frames and their boxes are published to a ring in shared memory
+ * that any number of viewers can map (alerts already go through the alert
+ * stream). Since this process owns the alerts, they are also saved
+ * periodically and when the process quits.
+ * Must be called after start(), once the cameras are open. Many backends
+ * report no size until a frame is decoded, so a frame is read from those
+ * cameras to size the slots.
+ *
+ * @return True if the ring could be created.
+ */
+bool engineHost::publish() {
+    // Size the slots for the largest camera
+    int maxFrameBytes = 0;
+    for (int i = 0; i < cameras.size(); ++i) {
+        int width = static_cast<int>(cameras[i].get(cv::CAP_PROP_FRAME_WIDTH));
+        int height = static_cast<int>(cameras[i].get(cv::CAP_PROP_FRAME_HEIGHT));
+        if (width <= 0 || height <= 0) {
+            cv::Mat first;
+            if (cameras[i].read(first)) {
+                width = first.cols;
+                height = first.rows;
+            }
+        }
+        if (width <= 0 || height <= 0) {
+            qWarning() << "No se pudo obtener el tamaño de los cuadros de la cámara" << i;
+        }
+        maxFrameBytes = qMax(maxFrameBytes, width * height * 3);
+    }
+
+    if (maxFrameBytes <= 0) {
+        qWarning() << "No hay cuadros para publicar: ninguna cámara informó su tamaño.";
+        return false;
+    }
+
+    if (!ring.create(frameRingKey, cameras.size(), 4, maxFrameBytes)) {
+        return false;
+    }
+
+    // Save the alerts regularly and on exit
+    QTimer *autosave = new QTimer(this);
+    connect(autosave, &QTimer::timeout, this, &engineHost::saveAlerts);
+    autosave->start(30000);
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &engineHost::saveAlerts);
+
+    publishing = true;
+    qDebug() << "Publishing" << cameras.size() << "cameras to" << frameRingKey << "and" << alertSocketName;
+    return true;
+}
+
+/**
+ * Starts recording every processed frame, with its timestamp, to a directory.
+ * The recording can be fed back through the pipeline with --replay.
+ * @param directory The directory where the recording is written.
+ * @see frameRecorder::open
+ */
+void engineHost::setRecordingDirectory(const QString &directory) {
+    recorder.open(directory, clock.origin(), cameras.size(), cameraSetupMs, engine.isUsingHog(), settings);
+}
+
+/**
+ * Returns the number of opened cameras.
+ */
+int engineHost::cameraCount() const {
+    return cameras.size();
+}
+
+/**
+ * Returns the alerts container of the engine.
+ */
+alertedObjects &engineHost::getAlerts() {
+    return alerts;
+}
+
+/**
+ * Returns the settings loaded by the engine.
+ */
+appSettings &engineHost::getSettings() {
+    return settings;
+}
+
+/**
+ * Saves the alerts to data/alerts.json.
+ */
+void engineHost::saveAlerts() {
+    alerts.saveAlerts("../../data/alerts.json");
+}
+
+/**
+ * Returns the region of interest of a camera, without copying it.
+ * @param camera The index of the camera.
+ */
+const regionOfInterest &engineHost::getRegion(int camera) const {
+    return engine.getRegion(camera);
+}
+
+/**
+ * Changes the region of interest of a camera and saves it in the "cameras"
+ * section of data/config.json.
+ * @param camera The index of the camera.
+ * @param region The new region, empty to scan the whole frame.
+ */
+void engineHost::setRegion(int camera, const regionOfInterest &region) {
+    engine.setRegion(camera, region);
+
+    QJsonObject cameraSettings = settings.section("cameras");
+    QJsonObject entry = cameraSettings[QString::number(camera)].toObject();
+    entry["roi"] = region.toJson();
+    entry["nextZoneId"] = region.getNextId(); // Ids of removed zones are not given again
+    cameraSettings[QString::number(camera)] = entry;
+    settings.setSection("cameras", cameraSettings);
+    settings.saveSettings("../../data/config.json");
+    recorder.recordSettings(settings);
+
+    if (camera < cameras.size()) {
+        cv::Size frameSize(static_cast<int>(cameras[camera].get(cv::CAP_PROP_FRAME_WIDTH)),
+                           static_cast<int>(cameras[camera].get(cv::CAP_PROP_FRAME_HEIGHT)));
+        qDebug() << "Camera" << camera << "now scans" << qRound(region.scannedFraction(frameSize) * 100) << "% of the frame";
+    }
+}
+
+/**
+ * Opens every available camera, stopping at the first one that cannot be opened.
+ */
+void engineHost::setCameras() {
+    const QList<QCameraDevice> detectedCameras = QMediaDevices::videoInputs();
+
+    int cameraCount = detectedCameras.size();
+
+    for (int i = 0; i < cameraCount; i++) {
+        cv::VideoCapture cap(i);
+
+        if (!cap.isOpened()) {
+            qDebug() << "Camera" << i << "not available.";
+            break;
+        }
+
+        // Store the VideoCapture object
+        cameras.append(std::move(cap));
+    }
+
+    // The same timestamp is recorded, so the replay starts the cooldowns where the live run did
+    cameraSetupMs = clock.nowMs();
+    engine.setCameraCount(cameras.size(), cameraSetupMs);
+    pool.setCameraCount(cameras.size());
+}
+
+/**
+ * Updates the frames of all cameras and performs object detection.
+ * Each camera reads into a buffer of its frame pool, so once the loop is warm
+ * no frame is allocated; the handle travels with the frame to the display and
+ * the buffer is reused when the last handle is released.
+ * Each frame is stamped with the monotonic time of the tick and handed to the
+ * detection engine, which draws the detections, tracks the objects and raises
+ * the alerts (saving the image to the data/img directory).
+ * The annotated frame is then emitted for display and, when publishing,
+ * written to the shared ring; new alerts are emitted (and published to the
+ * alert stream by the alerts container).
+ * Finally, the engine cleans up the objects that are no longer detected.
+ * The time spent on each camera is reported to the scheduler, which decides the
+ * degradation level and the delay before the next tick.
+ * @see detectionEngine::processFrame
+ * @see frameScheduler::endTick
+ */
+void engineHost::updateFrames() {
+    qint64 timestampMs = clock.nowMs();
+
+    QElapsedTimer tickTimer;
+    tickTimer.start();
+    scheduler.beginTick();
+
+    for (int i = 0; i < cameras.size(); ++i) {
+        QElapsedTimer cameraTimer;
+        cameraTimer.start();
+
+        // Pooled buffer, read and converted in place of the previous frames of the camera
+        framePool::handle buffer = pool.acquire(i);
+        cv::Mat &frame = buffer.capture();
+        if (cameras[i].read(frame) && !frame.empty()) {
+            buffer.frame().create(frame.size(), frame.type());
+            detectionEngine::timedFrame input(i, timestampMs, frame, buffer.frame());
+
+            // Detection is skipped for idle cameras and downscaled when the loop is overloaded
+            bool detect = scheduler.shouldDetect(i);
+            double detectionScale = scheduler.detectionScale();
+
+            // Record the frame as captured, before the engine converts it
+            recorder.record(input, detectionScale, detect);
+
+            detectionEngine::frameResult result = engine.processFrame(input, detectionScale, detect);
+            recorder.recordDetections(i, result.rawDetections, static_cast<int>(result.detections.size()));
+
+            if (!result.alertId.isEmpty()) {
+                recorder.recordAlert(i, result.alertId);
+                emit alertRaised(result.alertId);
+            }
+
+            // Display the frame, skipped on alternate ticks when the loop is overloaded
+            if (scheduler.shouldDisplay(i)) {
+                emit frameReady(i, buffer, result.alertLevel, result.scannedFraction);
+
+                if (publishing) {
+                    sharedFrameRing::frameInfo info;
+                    info.camera = i;
+                    info.timestampMs = timestampMs;
+                    info.alertLevel = result.alertLevel;
+                    info.scannedFraction = result.scannedFraction;
+                    info.boxes = result.detections;
+                    ring.publish(buffer.frame(), info);
+                }
+            }
+
+            scheduler.recordCameraCost(i, cameraTimer.elapsed(), !result.detections.empty());
+        }
+    }
+    engine.endTick(timestampMs);
+    recorder.endTick(timestampMs);
+
+    // Let the scheduler adapt the degradation level and schedule the next tick
+    frameScheduler::degradation previousLevel = scheduler.level();
+    int nextDelay = scheduler.endTick(tickTimer.elapsed());
+
+    if (scheduler.level() != previousLevel) {
+        emit degradationChanged(scheduler.level(), scheduler.levelName());
+    }
+
+    timer->start(nextDelay);
+}
@@ -0,0 +1,97 @@
+#ifndef ENGINEHOST_H
+#define ENGINEHOST_H
+
+#include "appsettings.h"
+#include "frameclock.h"
+#include "alertedobjects.h"
+#include "detectionengine.h"
+#include "framescheduler.h"
+#include "framerecorder.h"
+#include "sharedframering.h"
+#include "alertstream.h"
+#include "framepool.h"
+#include "retentionmanager.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QList>
+
+#include <opencv2/opencv.hpp>
+
+// Class that owns the cameras and runs the capture/detection loop, in the GUI process or on its own
+class engineHost : public QObject {
+    Q_OBJECT
+
+public:
+    // Names of the shared segment and the alert socket used between processes
+    static const QString frameRingKey;
+    static const QString alertSocketName;
+
+    engineHost(QObject *parent = nullptr);
+    ~engineHost();
+
+    void start();
+    bool publish();
+    void setRecordingDirectory(const QString &directory);
+
+    // Access
+    int cameraCount() const;
+    alertedObjects &getAlerts();
+    appSettings &getSettings();
+    void saveAlerts();
+
+    // Regions of interest, stored in the settings
+    const regionOfInterest &getRegion(int camera) const;
+    void setRegion(int camera, const regionOfInterest &region);
+
+signals:
+    // Emitted with the pooled buffer of the annotated frame; copy the handle to keep it past the emission
+    void frameReady(int camera, const framePool::handle &frame, int alertLevel, double scannedFraction);
+    void alertRaised(const QString &id);
+    void alertsRemoved(const QStringList &ids);
+    void degradationChanged(int level, const QString &name);
+
+private slots:
+    void updateFrames();
+
+private:
+    appSettings settings;
+
+    // Monotonic clock that timestamps every frame
+    steadyClock clock;
+
+    // Class instance to store that have been detected
+    alertedObjects alerts;
+
+    // Detection, tracking and alerting (declared after the clock and alerts it uses)
+    detectionEngine engine;
+    qint64 cameraSetupMs = 0;
+
+    // Adapts the frame loop to the measured cost of each tick
+    frameScheduler scheduler;
+
+    // Optional recording of the frames for deterministic replay
+    frameRecorder recorder;
+
+    // *Camera
+    QVector<cv::VideoCapture> cameras;
+    framePool pool;
+    QTimer *timer;
+
+    // Alert events for local subscribers (viewers and other tools)
+    alertStream *stream;
+
+    // Keeps the snapshots and alert records within their budgets
+    retentionManager *retention;
+
+    // Frames for viewers in other processes (only when running as a separate engine)
+    sharedFrameRing ring;
+    bool publishing = false;
+
+    // Private helper functions
+    void setCameras();
+};
+
+#endif // ENGINEHOST_H
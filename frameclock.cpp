@@ -0,0 +1,57 @@
+#include "frameclock.h"
+
+/**
+ * Converts a timestamp of this clock to wall time.
+ * @param timestampMs Milliseconds since the clock origin.
+ * @return The date and time corresponding to the timestamp.
+ */
+QDateTime frameClock::wallTime(qint64 timestampMs) const {
+    return originTime.addMSecs(timestampMs);
+}
+
+/**
+ * Returns the wall time at which the clock started counting.
+ */
+QDateTime frameClock::origin() const {
+    return originTime;
+}
+
+/**
+ * Constructor for steadyClock.
+ * Takes the current wall time as origin and starts the monotonic timer.
+ */
+steadyClock::steadyClock() {
+    originTime = QDateTime::currentDateTime();
+    elapsed.start();
+}
+
+/**
+ * Returns the milliseconds elapsed since the clock was created.
+ * Unlike QTime::currentTime, this never goes back (e.g. across midnight).
+ */
+qint64 steadyClock::nowMs() const {
+    return elapsed.elapsed();
+}
+
+/**
+ * Constructor for manualClock.
+ * @param origin The wall time corresponding to timestamp 0.
+ */
+manualClock::manualClock(const QDateTime &origin) {
+    originTime = origin;
+}
+
+/**
+ * Returns the last time set on the clock.
+ */
+qint64 manualClock::nowMs() const {
+    return currentMs;
+}
+
+/**
+ * Moves the clock to the given timestamp.
+ * @param timestampMs Milliseconds since the clock origin.
+ */
+void manualClock::setTime(qint64 timestampMs) {
+    currentMs = timestampMs;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAMECLOCK_H
+#define FRAMECLOCK_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+// Interface for the clock that timestamps the frames of the pipeline
+class frameClock
+{
+public:
+    virtual ~frameClock() = default;
+
+    // Monotonic milliseconds since the clock origin
+    virtual qint64 nowMs() const = 0;
+
+    // Wall time of a timestamp, only used for naming and displaying
+    QDateTime wallTime(qint64 timestampMs) const;
+    QDateTime origin() const;
+
+protected:
+    QDateTime originTime;
+};
+
+// Clock backed by the monotonic system timer, used for live cameras
+class steadyClock : public frameClock
+{
+public:
+    steadyClock();
+    qint64 nowMs() const override;
+
+private:
+    QElapsedTimer elapsed;
+};
+
+// Clock that only moves when told to, used for replaying recordings
+class manualClock : public frameClock
+{
+public:
+    manualClock(const QDateTime &origin);
+    qint64 nowMs() const override;
+    void setTime(qint64 timestampMs);
+
+private:
+    qint64 currentMs = 0;
+};
+
+#endif // FRAMECLOCK_H
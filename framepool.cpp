@@ -0,0 +1,134 @@
+#include "framepool.h"
+
+#include <utility>
+
+/**
+ * Takes a reference on a pooled buffer.
+ * @param data The buffer.
+ */
+framePool::handle::handle(buffer *data) : data(data) {
+    if (data) {
+        data->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Copies a handle, sharing the buffer.
+ */
+framePool::handle::handle(const handle &other) : handle(other.data) {}
+
+/**
+ * Moves a handle, leaving the other one null.
+ */
+framePool::handle::handle(handle &&other) noexcept : data(std::exchange(other.data, nullptr)) {}
+
+/**
+ * Replaces the buffer of the handle, releasing the previous one.
+ */
+framePool::handle &framePool::handle::operator=(handle other) noexcept {
+    std::swap(data, other.data);
+    return *this;
+}
+
+/**
+ * Releases the reference of the handle.
+ */
+framePool::handle::~handle() {
+    release();
+}
+
+/**
+ * Checks if the handle has no buffer.
+ */
+bool framePool::handle::isNull() const {
+    return data == nullptr;
+}
+
+/**
+ * Drops the reference of the handle. The buffer goes back to the pool when no
+ * other handle refers to it; its pixels stay allocated for the next frame.
+ */
+void framePool::handle::release() {
+    if (data) {
+        data->references.fetch_sub(1, std::memory_order_acq_rel);
+        data = nullptr;
+    }
+}
+
+/**
+ * Returns the BGR frame of the buffer, to be filled by the camera.
+ * Headers taken from it are only valid while the handle is held.
+ */
+cv::Mat &framePool::handle::capture() const {
+    return data->capture;
+}
+
+/**
+ * Returns the RGB frame of the buffer, where the pipeline converts the capture.
+ * Headers taken from it are only valid while the handle is held.
+ */
+cv::Mat &framePool::handle::frame() const {
+    return data->frame;
+}
+
+/**
+ * Resizes the pools to the given number of cameras, keeping the buffers of
+ * the cameras that remain. Must not be called while handles are held.
+ * @param count The number of cameras.
+ */
+void framePool::setCameraCount(int count) {
+    cameras.resize(qMax(0, count));
+}
+
+/**
+ * Returns a free buffer of a camera. A new buffer is only created when all of
+ * them are still referenced, so once the loop is warm the same few buffers
+ * cycle and cv::Mat::create finds them already allocated.
+ *
+ * @param camera The index of the camera.
+ * @return The handle, or a null handle for an unknown camera.
+ */
+framePool::handle framePool::acquire(int camera) {
+    if (camera < 0 || camera >= static_cast<int>(cameras.size())) {
+        return handle();
+    }
+
+    std::vector<std::unique_ptr<buffer>> &buffers = cameras[camera];
+    for (const std::unique_ptr<buffer> &b : buffers) {
+        if (b->references.load(std::memory_order_acquire) == 0) {
+            return handle(b.get());
+        }
+    }
+
+    buffers.push_back(std::make_unique<buffer>());
+    return handle(buffers.back().get());
+}
+
+/**
+ * Returns how many buffers the pool of a camera has grown to.
+ * @param camera The index of the camera.
+ */
+int framePool::bufferCount(int camera) const {
+    if (camera < 0 || camera >= static_cast<int>(cameras.size())) {
+        return 0;
+    }
+    return static_cast<int>(cameras[camera].size());
+}
+
+/**
+ * Scales a frame to fit in the given bounds keeping its aspect ratio, into a
+ * display buffer that is only reallocated when the target size changes.
+ *
+ * @param frame The RGB frame.
+ * @param bounds The size of the widget where it is shown.
+ * @param display The output buffer, kept by the caller between frames.
+ */
+void framePool::fitFrame(const cv::Mat &frame, const cv::Size &bounds, cv::Mat &display) {
+    if (frame.empty() || bounds.width <= 0 || bounds.height <= 0) {
+        return;
+    }
+
+    double scale = qMin(double(bounds.width) / frame.cols, double(bounds.height) / frame.rows);
+    cv::Size target(qMax(1, cvRound(frame.cols * scale)), qMax(1, cvRound(frame.rows * scale)));
+    cv::resize(frame, display, target, 0, 0, scale < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+}
@@ -0,0 +1,60 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Class for the per-camera pools of frame buffers reused by the frame loop
+class framePool
+{
+private:
+    // Struct for a pooled buffer: the frame as captured and its RGB conversion
+    struct buffer
+    {
+        cv::Mat capture;
+        cv::Mat frame;
+        std::atomic<int> references{0};
+    };
+
+public:
+    // Reference-counted handle to a pooled buffer, returned to the pool when the last copy is released
+    class handle
+    {
+    public:
+        handle() = default;
+        handle(const handle &other);
+        handle(handle &&other) noexcept;
+        handle &operator=(handle other) noexcept;
+        ~handle();
+
+        bool isNull() const;
+        void release();
+
+        // BGR frame as read from the camera
+        cv::Mat &capture() const;
+        // RGB frame given to the detector and the display
+        cv::Mat &frame() const;
+
+    private:
+        friend class framePool;
+        explicit handle(buffer *data);
+
+        buffer *data = nullptr;
+    };
+
+    void setCameraCount(int count);
+    handle acquire(int camera);
+    int bufferCount(int camera) const;
+
+    static void fitFrame(const cv::Mat &frame, const cv::Size &bounds, cv::Mat &display);
+
+private:
+    std::vector<std::vector<std::unique_ptr<buffer>>> cameras;
+};
+
+#endif // FRAMEPOOL_H
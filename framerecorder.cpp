@@ -0,0 +1,308 @@
+#include "framerecorder.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QDebug>
+
+/**
+ * Destructor for frameRecorder.
+ * Flushes and closes the index file if it is still open.
+ */
+frameRecorder::~frameRecorder() {
+    close();
+}
+
+/**
+ * Starts a recording in the given directory.
+ *
+ * The recording is a directory with one lossless PNG per frame, a copy of
+ * the settings (settings.json) and an index.csv file. The header of the index stores what is needed to rebuild
+ * the engine (clock origin, number of cameras, detector) and each row stores
+ * a frame with its tick, camera, timestamp and the scheduler decisions that
+ * were applied to it, the detections before and after the filter, an
+ * alert raised during the tick, a change of the settings, or the end of a
+ * tick with its timestamp (also for ticks without frames, since the tracked
+ * objects expire on every tick).
+ *
+ * @param directory The directory where the recording is written, created if needed.
+ * @param origin The wall time of the clock origin.
+ * @param cameraCount The number of cameras of the engine.
+ * @param setupMs The timestamp at which the camera state of the engine was reset.
+ * @param pedestrian True if the engine uses the HOG pedestrian detector.
+ * @param settings The settings of the engine, copied to settings.json in the recording.
+ * @return True if the index file could be created.
+ */
+bool frameRecorder::open(const QString &directory, const QDateTime &origin, int cameraCount, qint64 setupMs, bool pedestrian,
+                         appSettings settings) {
+    close();
+
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "No se pudo crear el directorio de grabación:" << directory;
+        return false;
+    }
+
+    this->directory = directory;
+    indexFile.setFileName(QDir(directory).filePath("index.csv"));
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "No se pudo crear el archivo:" << indexFile.fileName();
+        return false;
+    }
+
+    settings.saveSettings(QDir(directory).filePath("settings.json"));
+
+    index.setDevice(&indexFile);
+    index << "origin," << origin.toString(Qt::ISODateWithMs) << "\n";
+    index << "cameras," << cameraCount << "," << setupMs << "\n";
+    index << "detector," << (pedestrian ? "hog" : "haar") << "\n";
+
+    tick = 0;
+    frameCount = 0;
+    qDebug() << "Recording frames to" << directory;
+    return true;
+}
+
+/**
+ * Closes the current recording.
+ */
+void frameRecorder::close() {
+    if (indexFile.isOpen()) {
+        index.flush();
+        indexFile.close();
+    }
+}
+
+/**
+ * Checks if a recording is in progress.
+ */
+bool frameRecorder::isOpen() const {
+    return indexFile.isOpen();
+}
+
+/**
+ * Writes a frame, as captured (BGR), and its index row.
+ * PNG with the lowest compression level is used so that the replay sees the
+ * exact same pixels without slowing down the frame loop too much.
+ *
+ * @param frame The frame and its timestamp.
+ * @param detectionScale The detection scale chosen by the scheduler for this frame.
+ * @param detect Whether the detector ran on this frame.
+ */
+void frameRecorder::record(const detectionEngine::timedFrame &frame, double detectionScale, bool detect) {
+    if (!isOpen()) {
+        return;
+    }
+
+    QString file = QString("%1.png").arg(frameCount++);
+    cv::imwrite(QDir(directory).filePath(file).toStdString(), frame.image, {cv::IMWRITE_PNG_COMPRESSION, 1});
+
+    index << "frame," << tick << "," << frame.camera << "," << frame.timestampMs << ","
+          << detectionScale << "," << (detect ? 1 : 0) << "," << file << "\n";
+}
+
+/**
+ * Writes an alert raised during the current tick, used to verify replays.
+ * @param camera The camera where the alert was raised.
+ * @param id The id of the alert.
+ */
+void frameRecorder::recordAlert(int camera, const QString &id) {
+    if (!isOpen()) {
+        return;
+    }
+
+    index << "alert," << tick << "," << camera << "," << id << "\n";
+}
+
+/**
+ * Writes how many detections of a frame the detector returned and how many
+ * survived the filter.
+ * @param camera The camera of the frame.
+ * @param raw The detections before the filter.
+ * @param kept The detections after the filter.
+ */
+void frameRecorder::recordDetections(int camera, int raw, int kept) {
+    if (!isOpen()) {
+        return;
+    }
+
+    index << "detections," << tick << "," << camera << "," << raw << "," << kept << "\n";
+}
+
+/**
+ * Saves the settings after a change made during the recording (e.g. a region
+ * of interest drawn on a camera), applied by the replay from the current tick.
+ * @param settings The settings of the engine after the change.
+ */
+void frameRecorder::recordSettings(appSettings settings) {
+    if (!isOpen()) {
+        return;
+    }
+
+    QString file = QString("settings-%1.json").arg(tick);
+    settings.saveSettings(QDir(directory).filePath(file));
+    index << "settings," << tick << "," << file << "\n";
+}
+
+/**
+ * Marks the end of a tick of the frame loop, with its timestamp.
+ * @param timestampMs The timestamp of the tick.
+ */
+void frameRecorder::endTick(qint64 timestampMs) {
+    if (isOpen()) {
+        index << "tick," << tick << "," << timestampMs << "\n";
+    }
+    tick++;
+}
+
+/**
+ * Loads the index of a recording.
+ * @param directory The directory of the recording.
+ * @return True if the index could be read and contains at least one frame.
+ */
+bool frameReplayer::open(const QString &directory) {
+    QFile file(QDir(directory).filePath("index.csv"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "No se pudo abrir el archivo:" << file.fileName();
+        return false;
+    }
+
+    this->directory = directory;
+    frames.clear();
+    tickTimes.clear();
+    settingsChanges.clear();
+    expectedAlerts.clear();
+
+    // Settings of the live run (regions of interest, ...), missing in old recordings
+    settings.loadSettings(QDir(directory).filePath("settings.json"));
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QStringList fields = in.readLine().split(',');
+        const QString &kind = fields.first();
+
+        if (kind == "origin" && fields.size() == 2) {
+            origin = QDateTime::fromString(fields[1], Qt::ISODateWithMs);
+        } else if (kind == "cameras" && fields.size() == 3) {
+            cameraCount = fields[1].toInt();
+            setupMs = fields[2].toLongLong();
+        } else if (kind == "detector" && fields.size() == 2) {
+            pedestrian = fields[1] == "hog";
+        } else if (kind == "frame" && fields.size() == 7) {
+            frames.append({fields[1].toLongLong(), fields[2].toInt(), fields[3].toLongLong(),
+                           fields[4].toDouble(), fields[5] == "1", fields[6]});
+            tickTimes.insert(frames.last().tick, frames.last().timestampMs); // Recordings without tick rows
+        } else if (kind == "tick" && fields.size() == 3) {
+            tickTimes.insert(fields[1].toLongLong(), fields[2].toLongLong());
+        } else if (kind == "settings" && fields.size() == 3) {
+            settingsChanges.insert(fields[1].toLongLong(), fields[2]);
+        } else if (kind == "alert" && fields.size() == 4) {
+            expectedAlerts.append({fields[1].toLongLong(), fields[2].toInt(), fields[3]});
+        } else if (kind == "detections" && fields.size() == 5) {
+            recordedRaw += fields[3].toLongLong();
+            recordedKept += fields[4].toLongLong();
+        } else {
+            qWarning() << "Línea inválida en el índice de grabación, omitiendo.";
+        }
+    }
+
+    if (!origin.isValid() || frames.isEmpty()) {
+        qWarning() << "Grabación inválida o vacía:" << directory;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Feeds every recorded frame through a fresh engine as fast as possible.
+ *
+ * The engine runs on a manual clock that jumps to the timestamp of each tick,
+ * so the tracking and alert thresholds behave as they did live. Every recorded
+ * tick is closed, with or without frames, and the regions of interest changed
+ * during the recording are applied from the tick they were changed. The alerts
+ * raised are compared with the ones recorded and written to replay_alerts.json
+ * in the recording directory.
+ *
+ * @return 0 if the replay raised exactly the recorded alerts, 1 otherwise.
+ */
+int frameReplayer::replay() {
+    manualClock clock(origin);
+    alertedObjects alerts;
+    detectionEngine engine(&clock, &alerts);
+
+    detectorProfile profile = detectorProfile::fromJson(settings.section("detectorProfile"));
+    profile.pedestrian = pedestrian;
+    engine.loadDetector(profile);
+    engine.configure(settings);
+    engine.setSaveSnapshots(false);
+    clock.setTime(setupMs);
+    engine.setCameraCount(cameraCount, setupMs);
+
+    QList<recordedAlert> replayedAlerts;
+    qint64 replayedRaw = 0;
+    qint64 replayedKept = 0;
+    int next = 0;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    for (auto tick = tickTimes.constBegin(); tick != tickTimes.constEnd(); ++tick) {
+        const qint64 currentTick = tick.key();
+        const qint64 tickTimestamp = tick.value();
+        clock.setTime(tickTimestamp);
+
+        // Regions drawn during the recording, before the frames of the tick as in the live loop
+        auto changed = settingsChanges.constFind(currentTick);
+        if (changed != settingsChanges.constEnd()) {
+            appSettings changedSettings;
+            changedSettings.loadSettings(QDir(directory).filePath(changed.value()));
+            engine.setRegions(changedSettings.section("cameras"));
+        }
+
+        for (; next < frames.size() && frames[next].tick == currentTick; next++) {
+            const recordedFrame &recorded = frames[next];
+
+            cv::Mat image = cv::imread(QDir(directory).filePath(recorded.file).toStdString(), cv::IMREAD_COLOR);
+            if (image.empty()) {
+                qWarning() << "No se pudo leer el cuadro:" << recorded.file;
+                continue;
+            }
+
+            detectionEngine::timedFrame frame(recorded.camera, recorded.timestampMs, image);
+            detectionEngine::frameResult result = engine.processFrame(frame, recorded.detectionScale, recorded.detect);
+            replayedRaw += result.rawDetections;
+            replayedKept += static_cast<qint64>(result.detections.size());
+
+            if (!result.alertId.isEmpty()) {
+                replayedAlerts.append({currentTick, recorded.camera, result.alertId});
+            }
+        }
+
+        // Close the tick, as the live loop does
+        engine.endTick(tickTimestamp);
+    }
+
+    qint64 replayMs = elapsed.elapsed();
+    qint64 recordedMs = frames.last().timestampMs - frames.first().timestampMs;
+
+    alerts.saveAlerts(QDir(directory).filePath("replay_alerts.json"));
+
+    qInfo().noquote() << QString("Replayed %1 frames (%2 s of footage) in %3 s, %4x real time")
+                             .arg(frames.size())
+                             .arg(recordedMs / 1000.0, 0, 'f', 1)
+                             .arg(replayMs / 1000.0, 0, 'f', 1)
+                             .arg(replayMs > 0 ? double(recordedMs) / replayMs : 0.0, 0, 'f', 1);
+
+    qInfo().noquote() << QString("Detections: %1 raw, %2 after the filter (recorded: %3 raw, %4 after the filter)")
+                             .arg(replayedRaw)
+                             .arg(replayedKept)
+                             .arg(recordedRaw)
+                             .arg(recordedKept);
+
+    if (replayedAlerts != expectedAlerts) {
+        qWarning() << "Las alertas de la reproducción no coinciden con las grabadas:"
+                   << replayedAlerts.size() << "vs" << expectedAlerts.size();
+        return 1;
+    }
+
+    qInfo() << "Alerts match the recording:" << replayedAlerts.size();
+    return 0;
+}
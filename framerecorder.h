@@ -0,0 +1,83 @@
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include "detectionengine.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+// Class to record the frames of the pipeline, with their timestamps, to a directory
+class frameRecorder
+{
+public:
+    ~frameRecorder();
+
+    bool open(const QString &directory, const QDateTime &origin, int cameraCount, qint64 setupMs, bool pedestrian,
+              appSettings settings);
+    void close();
+    bool isOpen() const;
+
+    void record(const detectionEngine::timedFrame &frame, double detectionScale, bool detect);
+    void recordAlert(int camera, const QString &id);
+    void recordDetections(int camera, int raw, int kept);
+    void recordSettings(appSettings settings);
+    void endTick(qint64 timestampMs);
+
+private:
+    QString directory;
+    QFile indexFile;
+    QTextStream index;
+    qint64 tick = 0;
+    qint64 frameCount = 0;
+};
+
+// Class to feed a recording through the pipeline as fast as possible
+class frameReplayer
+{
+public:
+    bool open(const QString &directory);
+    int replay();
+
+private:
+    // Struct for a recorded frame
+    struct recordedFrame
+    {
+        qint64 tick;
+        int camera;
+        qint64 timestampMs;
+        double detectionScale;
+        bool detect;
+        QString file;
+    };
+
+    // Struct for an alert raised while recording
+    struct recordedAlert
+    {
+        qint64 tick;
+        int camera;
+        QString id;
+
+        bool operator==(const recordedAlert &other) const {
+            return tick == other.tick && camera == other.camera && id == other.id;
+        }
+    };
+
+    QString directory;
+    QDateTime origin;
+    int cameraCount = 0;
+    qint64 setupMs = 0;
+    bool pedestrian = false;
+    appSettings settings;
+    QList<recordedFrame> frames;
+    QMap<qint64, qint64> tickTimes;        // Timestamp of every tick, with frames or not
+    QMap<qint64, QString> settingsChanges; // Settings saved during the recording, by the tick they apply from
+    QList<recordedAlert> expectedAlerts;
+    qint64 recordedRaw = 0;
+    qint64 recordedKept = 0;
+};
+
+#endif // FRAMERECORDER_H
@@ -0,0 +1,170 @@
+#include "framescheduler.h"
+
+#include <QDebug>
+
+/**
+ * Constructor for frameScheduler.
+ * @param targetLatencyMs The end-to-end latency budget of a tick, in milliseconds.
+ */
+frameScheduler::frameScheduler(int targetLatencyMs) : targetLatencyMs(targetLatencyMs) {}
+
+/**
+ * Resizes the per-camera statistics to the given number of cameras.
+ * @param count The number of cameras handled by the frame loop.
+ */
+void frameScheduler::setCameraCount(int count) {
+    stats.resize(count);
+    stats.fill(cameraStats());
+}
+
+/**
+ * Changes the latency budget of a tick.
+ * @param targetLatencyMs The new budget, in milliseconds.
+ */
+void frameScheduler::setTargetLatency(int targetLatencyMs) {
+    this->targetLatencyMs = targetLatencyMs;
+}
+
+/**
+ * Marks the beginning of a new tick of the frame loop.
+ */
+void frameScheduler::beginTick() {
+    tickCount++;
+}
+
+/**
+ * Records the time spent processing one camera in the current tick.
+ * The cost is smoothed with an exponential moving average so that a single
+ * slow frame does not change the degradation level.
+ *
+ * @param index The index of the camera.
+ * @param elapsedMs The time spent reading, detecting and displaying the frame.
+ * @param hasDetections Whether the detector found anything in the frame.
+ */
+void frameScheduler::recordCameraCost(int index, qint64 elapsedMs, bool hasDetections) {
+    if (index < 0 || index >= stats.size()) {
+        return;
+    }
+
+    cameraStats &cam = stats[index];
+    cam.averageCostMs = (1.0 - smoothing) * cam.averageCostMs + smoothing * elapsedMs;
+    cam.idleTicks = hasDetections ? 0 : cam.idleTicks + 1;
+}
+
+/**
+ * Closes the current tick, updating the degradation level and returning the
+ * delay until the next tick.
+ *
+ * The loop is overloaded when the whole tick or any camera exceeds its budget.
+ * After several overloaded ticks in a row the level goes up one step; after a
+ * longer run of ticks comfortably under budget it goes down one step.
+ *
+ * @param tickElapsedMs The time spent in the whole tick.
+ * @return The delay in milliseconds before the next tick should start.
+ */
+int frameScheduler::endTick(qint64 tickElapsedMs) {
+    int budget = cameraBudgetMs();
+    bool overloaded = tickElapsedMs > targetLatencyMs;
+    bool underloaded = tickElapsedMs < targetLatencyMs * relaxRatio;
+
+    for (const cameraStats &cam : stats) {
+        if (cam.averageCostMs > budget) {
+            overloaded = true;
+        }
+        if (cam.averageCostMs > budget * relaxRatio) {
+            underloaded = false;
+        }
+    }
+
+    overloadedTicks = overloaded ? overloadedTicks + 1 : 0;
+    underloadedTicks = underloaded ? underloadedTicks + 1 : 0;
+
+    if (overloadedTicks >= ticksToDegrade && currentLevel < ReduceIdleDetection) {
+        currentLevel = static_cast<degradation>(currentLevel + 1);
+        overloadedTicks = 0;
+        qDebug() << "Frame loop overloaded, degrading to" << levelName();
+    } else if (underloadedTicks >= ticksToRecover && currentLevel > None) {
+        currentLevel = static_cast<degradation>(currentLevel - 1);
+        underloadedTicks = 0;
+        qDebug() << "Frame loop recovered, back to" << levelName();
+    }
+
+    // Wait only for what is left of the budget, never queue ticks
+    return qMax<qint64>(0, targetLatencyMs - tickElapsedMs);
+}
+
+/**
+ * Checks if the frame of a camera should be displayed in the current tick.
+ * @param index The index of the camera.
+ * @return False on every other tick once display frames are being skipped.
+ */
+bool frameScheduler::shouldDisplay(int index) const {
+    if (currentLevel < SkipDisplay) {
+        return true;
+    }
+    return (tickCount + index) % 2 == 0;
+}
+
+/**
+ * Checks if the detector should run on a camera in the current tick.
+ * @param index The index of the camera.
+ * @return False for idle cameras outside their detection interval at the highest level.
+ */
+bool frameScheduler::shouldDetect(int index) const {
+    if (currentLevel < ReduceIdleDetection || !isIdle(index)) {
+        return true;
+    }
+    return (tickCount + index) % idleDetectionInterval == 0;
+}
+
+/**
+ * Returns the factor applied to the frame size before detection.
+ * @return 1.0 at normal resolution, 0.5 once the resolution has been lowered.
+ */
+double frameScheduler::detectionScale() const {
+    return currentLevel >= LowerResolution ? 0.5 : 1.0;
+}
+
+/**
+ * Returns the current degradation level.
+ */
+frameScheduler::degradation frameScheduler::level() const {
+    return currentLevel;
+}
+
+/**
+ * Returns a readable name for the current degradation level.
+ */
+QString frameScheduler::levelName() const {
+    switch (currentLevel) {
+    case SkipDisplay:
+        return "Omitiendo cuadros";
+    case LowerResolution:
+        return "Resolución reducida";
+    case ReduceIdleDetection:
+        return "Detección reducida";
+    default:
+        return "Normal";
+    }
+}
+
+/**
+ * Returns the share of the tick budget that belongs to each camera.
+ */
+int frameScheduler::cameraBudgetMs() const {
+    if (stats.isEmpty()) {
+        return targetLatencyMs;
+    }
+    return qMax(1, targetLatencyMs / static_cast<int>(stats.size()));
+}
+
+/**
+ * Checks if a camera has gone long enough without detections to be considered idle.
+ * @param index The index of the camera.
+ */
+bool frameScheduler::isIdle(int index) const {
+    if (index < 0 || index >= stats.size()) {
+        return false;
+    }
+    return stats[index].idleTicks >= idleTicksThreshold;
+}
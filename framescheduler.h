@@ -0,0 +1,71 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QVector>
+#include <QString>
+
+// Class to schedule the frame loop according to the measured cost of each tick
+class frameScheduler
+{
+public:
+    // Degradation levels, applied in order when the loop is overloaded
+    enum degradation {
+        None = 0,               // Everything is processed
+        SkipDisplay = 1,        // Only every other frame is displayed
+        LowerResolution = 2,    // Detection runs on a downscaled frame
+        ReduceIdleDetection = 3 // Idle cameras run detection less often
+    };
+
+    frameScheduler(int targetLatencyMs = 30);
+
+    // Configuration
+    void setCameraCount(int count);
+    void setTargetLatency(int targetLatencyMs);
+
+    // Tick bookkeeping
+    void beginTick();
+    void recordCameraCost(int index, qint64 elapsedMs, bool hasDetections);
+    int endTick(qint64 tickElapsedMs);
+
+    // Decisions for the current tick
+    bool shouldDisplay(int index) const;
+    bool shouldDetect(int index) const;
+    double detectionScale() const;
+
+    // State
+    degradation level() const;
+    QString levelName() const;
+
+private:
+    // Struct for the per-camera statistics
+    struct cameraStats
+    {
+        double averageCostMs;
+        int idleTicks;
+
+        cameraStats() : averageCostMs(0.0), idleTicks(0) {}
+    };
+
+    int targetLatencyMs;
+    degradation currentLevel = None;
+    QVector<cameraStats> stats;
+    qint64 tickCount = 0;
+
+    // Consecutive ticks over or under budget (hysteresis)
+    int overloadedTicks = 0;
+    int underloadedTicks = 0;
+
+    // Tuning
+    const double smoothing = 0.2;        // Weight of the newest sample in the moving average
+    const double relaxRatio = 0.6;       // Fraction of the budget under which the load is considered low
+    const int ticksToDegrade = 5;
+    const int ticksToRecover = 30;
+    const int idleTicksThreshold = 30;   // Ticks without detections before a camera is idle
+    const int idleDetectionInterval = 4; // Idle cameras detect once every this many ticks
+
+    // Private helper functions
+    int cameraBudgetMs() const;
+    bool isIdle(int index) const;
+};
+
+#endif // FRAMESCHEDULER_H
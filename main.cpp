@@ -1,11 +1,98 @@
 #include "mainwindow.h"
+#include "enginehost.h"
+#include "framerecorder.h"
+#include "benchmarks.h"
 #include <QApplication>
 #include <QMediaCaptureSession>
+#include <QCommandLineParser>
+
+// Creates a QCoreApplication for the modes without a window, so they also run without a display
+static QCoreApplication *createApplication(int &argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        QByteArray arg(argv[i]);
+        if (arg == "--engine" || arg == "--replay" || arg.startsWith("--bench-")) {
+            return new QCoreApplication(argc, argv);
+        }
+    }
+    return new QApplication(argc, argv);
+}
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-    MainWindow w;
+    QScopedPointer<QCoreApplication> a(createApplication(argc, argv));
+
+    // Command line options
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption recordOption("record", "Graba los cuadros procesados en <dir>.", "dir");
+    QCommandLineOption replayOption("replay", "Reproduce la grabación de <dir> sin interfaz, tan rápido como sea posible.", "dir");
+    QCommandLineOption engineOption("engine", "Ejecuta solo la captura y detección, publicando los cuadros para los visores.");
+    QCommandLineOption viewerOption("viewer", "Muestra los cuadros publicados por un proceso --engine.");
+    QCommandLineOption benchEncodersOption("bench-encoders", "Mide el costo de cada opción de captura sobre las imágenes de <dir>.", "dir");
+    QCommandLineOption benchDetectorOption("bench-detector", "Barre los parámetros del detector sobre las imágenes de <dir>.", "dir");
+    QCommandLineOption benchPipelineOption("bench-pipeline", "Mide el costo por cuadro del pipeline aparte del detector sobre las imágenes de <dir>.", "dir");
+    QCommandLineOption benchFramePoolOption("bench-frame-pool", "Cuenta las reservas de cv::Mat por cuadro con y sin el pool de cuadros, con las imágenes de <dir> (sin el QPixmap de la visualización).", "dir");
+    QCommandLineOption benchRulesOption("bench-rules", "Mide el costo por ciclo del seguimiento y las reglas de alerta con miles de objetos sintéticos.");
+    QCommandLineOption annotationsOption("annotations", "Etiquetas independientes para --bench-detector; sin ellas solo se mide el tiempo.", "file");
+    QCommandLineOption outputOption("output", "Archivo JSON donde se escriben los resultados del benchmark.", "file");
+    parser.addOption(recordOption);
+    parser.addOption(replayOption);
+    parser.addOption(engineOption);
+    parser.addOption(viewerOption);
+    parser.addOption(benchEncodersOption);
+    parser.addOption(benchDetectorOption);
+    parser.addOption(benchPipelineOption);
+    parser.addOption(benchFramePoolOption);
+    parser.addOption(benchRulesOption);
+    parser.addOption(annotationsOption);
+    parser.addOption(outputOption);
+    parser.process(*a);
+
+    // Benchmarks
+    if (parser.isSet(benchEncodersOption)) {
+        return benchmarks::snapshotEncoders(parser.value(benchEncodersOption));
+    }
+    if (parser.isSet(benchDetectorOption)) {
+        QString imageDir = parser.value(benchDetectorOption);
+        return benchmarks::detectorSweep(imageDir, parser.value(annotationsOption), parser.value(outputOption));
+    }
+    if (parser.isSet(benchPipelineOption)) {
+        return benchmarks::pipelineOverhead(parser.value(benchPipelineOption));
+    }
+    if (parser.isSet(benchFramePoolOption)) {
+        return benchmarks::frameAllocations(parser.value(benchFramePoolOption));
+    }
+    if (parser.isSet(benchRulesOption)) {
+        return benchmarks::ruleEvaluation();
+    }
+
+    // Headless replay of a recording
+    if (parser.isSet(replayOption)) {
+        frameReplayer replayer;
+        if (!replayer.open(parser.value(replayOption))) {
+            return 1;
+        }
+        return replayer.replay();
+    }
+
+    // Capture and detection without a window, for separate viewers
+    if (parser.isSet(engineOption)) {
+        engineHost host;
+        host.start();
+        if (!host.publish()) {
+            return 1;
+        }
+        if (parser.isSet(recordOption)) {
+            host.setRecordingDirectory(parser.value(recordOption));
+        }
+        return a->exec();
+    }
+
+    MainWindow w(nullptr, parser.isSet(viewerOption));
+    if (parser.isSet(recordOption)) {
+        w.setRecordingDirectory(parser.value(recordOption));
+    }
     w.show();
-    return a.exec();
+    return a->exec();
 }
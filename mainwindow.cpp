@@ -3,59 +3,70 @@
 /**
  * Constructor for MainWindow.
  * Initializes the main window with a size of 1000x800.
- * Calls the setup functions for the UI, cascade, camera, and timer.
+ * Calls the setup functions for the UI, the camera views and the frame source.
+ * By default the capture and detection loop runs in this process; in viewer
+ * mode the window only displays what a separate engine process publishes.
  * @param parent The parent QWidget for this window.
+ * @param viewerMode True to attach to an engine started with --engine.
  */
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
+MainWindow::MainWindow(QWidget *parent, bool viewerMode) : QMainWindow(parent) {
     resize(1000, 800);
 
     createUI();
 
-    loadDetector(false);
-
-    alerts.loadAlerts("../../data/alerts.json");
-    updateAlertedList(alerts.getSortedByDate());
-
     // Connections for interactivity
     connect(alertsWidget, &QListWidget::itemDoubleClicked, this, &MainWindow::onItemClicked);
     connect(comboBoxSortOptions, SIGNAL(currentIndexChanged(int)), this, SLOT(onSortOptionChanged(int)));
 
-    setCameras();
+    if (viewerMode) {
+        // Alerts so far come from the file, new ones from the engine socket
+        alerts = &viewerAlerts;
+        viewerAlerts.loadAlerts("../../data/alerts.json");
+        updateAlertedList(alerts->getSortedByDate());
 
-    // Set up a timer to update frames
-    timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &MainWindow::updateFrames);
-    timer->start(30);  // Update every 30 ms (~33 FPS)
+        if (!attachToEngine()) {
+            titleLabel->setText("Camera Viewer (sin motor)");
+        }
+        return;
+    }
+
+    host = new engineHost(this);
+    alerts = &host->getAlerts();
+    updateAlertedList(alerts->getSortedByDate());
+
+    connect(host, &engineHost::frameReady, this, &MainWindow::showFrame);
+    connect(host, &engineHost::alertRaised, this, &MainWindow::onAlertRaised);
+    connect(host, &engineHost::alertsRemoved, this, [this]() {
+        onSortOptionChanged(comboBoxSortOptions->currentIndex());
+    });
+    connect(host, &engineHost::degradationChanged, this, &MainWindow::showDegradation);
+
+    host->start();
+    setCameras(host->cameraCount());
+
+    // Regions of interest are drawn on the camera labels
+    for (QLabel *cameraLabel : cameraLabels) {
+        cameraLabel->installEventFilter(this);
+    }
 }
 
 /**
  * Destructor for MainWindow.
- * Releases all camera resources when the window is closed.
+ * The cameras are released by the engine host.
  */
-MainWindow::~MainWindow() {
-    // Release all camera resources
-    for (auto &camera : cameras) {
-        if (camera.isOpened()) {
-            camera.release();
-        }
-    }
-}
+MainWindow::~MainWindow() {}
 
 /**
- * Loads the Haar Cascade and SVM classifier for face detection or pedestrian detection from the provided path.
- * If the load fails, prints an error message to the console.
+ * Starts recording every processed frame, with its timestamp, to a directory.
+ * Only available when the engine runs in this process.
+ * @param directory The directory where the recording is written.
+ * @see engineHost::setRecordingDirectory
  */
-void MainWindow::loadDetector(bool pedestrian) {
-    // Load the Haar Cascade classifier or the SVM classifier
-    if (pedestrian) {
-        pedestrianHOG.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
-        usingHog = true;
-    }
-    else {
-        if (!faceCascade.load("../../cascades/haarcascade_frontalface_default.xml")) { // Two orders above build folder
-            qDebug() << "Error loading face cascade classifier.";
-            return;
-        }
+void MainWindow::setRecordingDirectory(const QString &directory) {
+    if (host) {
+        host->setRecordingDirectory(directory);
+    } else {
+        qWarning() << "La grabación debe iniciarse en el proceso del motor.";
     }
 }
 
@@ -134,38 +145,22 @@ void MainWindow::createUI() {
 }
 
 /**
- * Initializes the available cameras, adding camera feeds to the grid layout.
- * 
- * This function detects all available video input devices and sets up a
- * grid layout to display each camera's feed and name. Each camera feed
- * is displayed in a QLabel with a minimum size of 320x240 pixels. The
- * function appends the camera's VideoCapture object and QLabel to
- * their respective lists for further processing.
- * 
- * If a camera is not available, it logs a message and stops processing.
+ * Adds a view for each camera to the grid layout.
+ *
+ * This function sets up a grid layout to display each camera's feed and
+ * name. Each camera feed is displayed in a QLabel with a minimum size of
+ * 320x240 pixels. The function appends the QLabels to their respective lists
+ * for further processing.
+ *
+ * @param cameraCount The number of cameras opened by the engine.
  */
-void MainWindow::setCameras() {
-    const QList<QCameraDevice> detectedCameras = QMediaDevices::videoInputs();
-
+void MainWindow::setCameras(int cameraCount) {
     int minWidth = 320;  // Width in pixels
     int minHeight = 240; // Height in pixels
 
-    int cameraCount = detectedCameras.size();
-    int cameraIndex = 0;
     int row = 0, col = 0;
 
-    alertLevelsAndTimes.resize(cameraCount);
-    alertLevelsAndTimes.fill({0, QTime::currentTime()});
-
-
     for (int i = 0; i < cameraCount; i++) {
-        cv::VideoCapture cap(cameraIndex);
-
-        if (!cap.isOpened()) {
-            qDebug() << "Camera" << cameraIndex << "not available.";
-            break;
-        }
-
         // Create a QLabel to display the name in the grid
         QLabel *cameraNameLabel = new QLabel(this);
         cameraNameLabels.append(cameraNameLabel);
@@ -178,21 +173,15 @@ void MainWindow::setCameras() {
         cameraLabels.append(cameraLabel);
         gridLayout->addWidget(cameraLabel, row + 1, col);
 
-        // Store the VideoCapture object
-        cameras.append(std::move(cap));
-
         // Update grid position
         col++;
         if (col >= 3) {
             col = 0;
             row += 2; // Move down two rows for the next camera feed and its FPS
         }
-
-        cameraIndex++;
     }
 }
 
-
 /**
  * Updates the label style of the camera at the given index to display the alert status.
  *
@@ -241,13 +230,13 @@ void MainWindow::onSortOptionChanged(int index) {
 
     switch (index) {
     case 0: // "Sort by Camera"
-        sortedList = alerts.getSortedByDate();
+        sortedList = alerts->getSortedByDate();
         break;
     case 1: // "Sort by Hour"
-        sortedList = alerts.getSortedByHour();
+        sortedList = alerts->getSortedByHour();
         break;
     case 2: // "Sort by Date"
-        sortedList = alerts.getSortedByCamera();
+        sortedList = alerts->getSortedByCamera();
         break;
     }
 
@@ -286,6 +275,9 @@ void MainWindow::updateAlertedList(QList<alertedObjects::alerted> alertedList) {
     for (const alertedObjects::alerted &alert : alertedList) {
         // Create a formatted string with the camera number, date, and time
         QString alertInfo = QString("CAM%1 - %2 - %3").arg(alert.camera).arg(alert.date.toString("yyyy-MM-dd"), alert.hour.toString());
+        if (alert.occurrences > 1) {
+            alertInfo += QString(" (x%1)").arg(alert.occurrences);
+        }
 
         // Create a new QListWidgetItem with the formatted string
         QListWidgetItem *item = new QListWidgetItem(alertInfo);
@@ -302,95 +294,321 @@ void MainWindow::updateAlertedList(QList<alertedObjects::alerted> alertedList) {
 
 
 /**
- * Updates the frames of all cameras and performs object detection.
- * If an object is detected, it will draw a red rectangle around it and
- * update the alert level and time if the object is not already being tracked.
- * If the object has been detected for more than 2 seconds, it will save an image
- * to the data/img directory and add the alert to the alerts list.
- * It will then update the alert list widget with the new alert.
- * Finally, it will call the removePastObjects function to clean up the hash of detected objects.
- * @see inDetectionObjects::removePastObjects
+ * Slot that displays an annotated frame of a camera and its alert status.
+ * The regions of interest of the camera are drawn over the frame, and the
+ * name label shows the share of the frame scanned by the detector.
+ * The frame is scaled into a buffer of the camera kept between ticks, so
+ * only the pixmap for the label is created per frame.
+ * @param index The index of the camera.
+ * @param frame The pooled buffer with the frame, in RGB, with the detections drawn.
+ * @param alertLevel The alert level of the camera.
+ * @param scannedFraction The fraction of the frame pixels given to the detector.
  */
-void MainWindow::updateFrames() {
-    QTime currentTime = QTime::currentTime();
-    QDate currentDate = QDate::currentDate();
+void MainWindow::showFrame(int index, const framePool::handle &frame, int alertLevel, double scannedFraction) {
+    if (index < 0 || index >= cameraLabels.size() || frame.isNull()) {
+        return;
+    }
 
-    for (int i = 0; i < cameras.size(); ++i) {
-        cv::Mat frame;
-        if (cameras[i].read(frame) && !frame.empty()) {
+    // Alert
+    displayAlert(alertLevel, index);
 
-            // Convert the frame from BGR to RGB
-            cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
+    // Scale to the label and convert cv::Mat to QImage
+    if (displayBuffers.size() <= index) {
+        displayBuffers.resize(cameraLabels.size());
+    }
+    cv::Mat &display = displayBuffers[index];
+    const QSize labelSize = cameraLabels[index]->size();
+    framePool::fitFrame(frame.frame(), cv::Size(labelSize.width(), labelSize.height()), display);
+    if (display.empty()) {
+        return;
+    }
+    QImage image(
+        display.data, display.cols, display.rows, display.step, QImage::Format_RGB888);
 
 
-            // Object detection
-            std::vector<cv::Rect> detections;
-            if (usingHog) {
-                pedestrianHOG.detectMultiScale(frame, detections);
-            } else {
-                faceCascade.detectMultiScale(frame, detections, 1.1, 3, 0, cv::Size(125, 125));
-            }
+    // Display the camera name
+    displayCameraName(index, scannedFraction);
 
 
-            // Draw rectangles around detected objects, and manage logic of detected objects
-            if (detections.empty()) {
-                alertLevelsAndTimes[i].first = 0;
-            } else {
-                for (const auto& detected : detections) {
-                    cv::rectangle(frame, detected, cv::Scalar(255, 0, 0), 2); // Draw a red rectangle
+    // Set the image to the QLabel
+    QPixmap pixmap = QPixmap::fromImage(image);
+    drawRegions(pixmap, index);
+    cameraLabels[index]->setPixmap(pixmap);
+}
+
+/**
+ * Displays the name of a camera, with the fraction of the frame it scans when
+ * a region of interest restricts the detector.
+ * @param index The index of the camera.
+ * @param scannedFraction The fraction of the frame pixels given to the detector.
+ */
+void MainWindow::displayCameraName(int index, double scannedFraction) {
+    if (scannedFraction < 1.0) {
+        cameraNameLabels[index]->setText(QString("CAM%1 (ROI %2%)").arg(index).arg(qRound(scannedFraction * 100)));
+    } else {
+        cameraNameLabels[index]->setText(QString("CAM%1").arg(index));
+    }
+}
 
-                    std::pair<int, int> position = {detected.x, detected.y}; // Position of the object
+/**
+ * Draws the regions of interest of a camera, labeled with their zone id for
+ * the alert rules, and the one being drawn, over its pixmap.
+ * @param pixmap The scaled frame of the camera.
+ * @param index The index of the camera.
+ */
+void MainWindow::drawRegions(QPixmap &pixmap, int index) {
+    auto toPolygon = [&pixmap](const std::vector<cv::Point2f> &points) {
+        QPolygonF polygon;
+        for (const cv::Point2f &point : points) {
+            polygon << QPointF(point.x * pixmap.width(), point.y * pixmap.height());
+        }
+        return polygon;
+    };
 
-                    QString currentId = objects.updateObject(i, position, currentTime); // Update the object (class inDetectionObjects)
+    const regionOfInterest &region = host->getRegion(index);
+    if (region.isEmpty() && drawingCamera != index) {
+        return;
+    }
 
-                    // Check if the object has been detected for more than 2 seconds
-                    if (alertLevelsAndTimes[i].second.secsTo(currentTime) > 2) {
-                        // Check if the object is already being tracked (class inDetectionObjects)
-                        if (objects.checkAlert(currentId)) {
+    QPainter painter(&pixmap);
+    painter.setPen(QPen(Qt::yellow, 2));
+    const auto &polygons = region.getPolygons();
+    for (size_t i = 0; i < polygons.size(); i++) {
+        QPolygonF polygon = toPolygon(polygons[i]);
+        painter.drawPolygon(polygon);
+        painter.drawText(polygon.first() + QPointF(4, 14), QString("Z%1").arg(region.getIds()[i]));
+    }
 
-                            alertLevelsAndTimes[i].first = 2; // Set the alert level to 2
-                            QString imgPath = QString("../../data/img/%1.png").arg(currentId);
+    if (drawingCamera == index) {
+        painter.setPen(QPen(Qt::cyan, 2, Qt::DashLine));
+        painter.drawPolyline(toPolygon(drawingPolygon));
+    }
+}
 
-                            // Save the image
-                            cv::Mat rgbFrame;
-                            cv::cvtColor(frame, rgbFrame, cv::COLOR_BGR2RGB);
-                            cv::imwrite(imgPath.toStdString(), rgbFrame);
+/**
+ * Converts a position on a camera label to frame coordinates normalized to [0, 1].
+ * The pixmap is centered in the label and keeps the aspect ratio of the frame.
+ * @param index The index of the camera.
+ * @param position The position in label coordinates.
+ * @param normalized The output position, normalized to the frame size.
+ * @return False if the position is outside the displayed frame.
+ */
+bool MainWindow::labelToFrame(int index, const QPoint &position, cv::Point2f &normalized) {
+    QLabel *label = cameraLabels[index];
+    QSize pixmapSize = label->pixmap().size();
+    if (pixmapSize.isEmpty()) {
+        return false;
+    }
 
-                            // Add the alert (class alertedObjects)
-                            alerts.insertAlerted(currentId, imgPath, currentDate, currentTime, i);
-                            alertLevelsAndTimes[i].second = QTime::currentTime();
+    QPointF origin((label->width() - pixmapSize.width()) / 2.0, (label->height() - pixmapSize.height()) / 2.0);
+    QPointF local = QPointF(position) - origin;
+    normalized = cv::Point2f(static_cast<float>(local.x() / pixmapSize.width()),
+                             static_cast<float>(local.y() / pixmapSize.height()));
 
-                            // Update the alert list widget with the current sorting method
-                            onSortOptionChanged(comboBoxSortOptions->currentIndex());
+    return normalized.x >= 0 && normalized.x <= 1 && normalized.y >= 0 && normalized.y <= 1;
+}
 
-                        } else {
-                            // Otherwise, set the alert level to 1 (no alert, only detection)
-                            alertLevelsAndTimes[i].first = 1;
-                            alertLevelsAndTimes[i].second = QTime::currentTime();
-                        }
-                    }
-                }
+/**
+ * Handles the drawing of regions of interest on the camera labels.
+ * The context menu of a label starts a new polygon or clears the regions of
+ * the camera. While drawing, each click adds a vertex and a double click
+ * closes the polygon, which is saved to the settings.
+ * @param watched The object that received the event.
+ * @param event The event.
+ * @return True if the event was handled.
+ */
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+    int index = cameraLabels.indexOf(qobject_cast<QLabel *>(watched));
+    if (index < 0 || !host) {
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+    switch (event->type()) {
+    case QEvent::ContextMenu: {
+        QMenu menu(this);
+        QAction *drawAction = menu.addAction("Dibujar región de interés");
+        QAction *clearAction = menu.addAction("Borrar regiones de interés");
+        QAction *selected = menu.exec(static_cast<QContextMenuEvent *>(event)->globalPos());
+
+        if (selected == drawAction) {
+            drawingCamera = index;
+            drawingPolygon.clear();
+        } else if (selected == clearAction) {
+            drawingCamera = -1;
+            regionOfInterest region = host->getRegion(index);
+            region.clear(); // Keeps the next zone id, so rules on the removed zones stay off
+            host->setRegion(index, region);
+        }
+        return true;
+    }
+    case QEvent::MouseButtonPress: {
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(event);
+        cv::Point2f point;
+        if (drawingCamera == index && mouseEvent->button() == Qt::LeftButton
+            && labelToFrame(index, mouseEvent->position().toPoint(), point)) {
+            drawingPolygon.push_back(point);
+            return true;
+        }
+        break;
+    }
+    case QEvent::MouseButtonDblClick: {
+        if (drawingCamera == index) {
+            if (drawingPolygon.size() >= 3) {
+                regionOfInterest region = host->getRegion(index);
+                region.addPolygon(drawingPolygon);
+                host->setRegion(index, region);
             }
+            drawingCamera = -1;
+            drawingPolygon.clear();
+            return true;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+/**
+ * Slot that shows the degradation level of the frame loop in the title.
+ * @param level The degradation level (0 when nothing is degraded).
+ * @param name The readable name of the level.
+ */
+void MainWindow::showDegradation(int level, const QString &name) {
+    titleLabel->setText(level == frameScheduler::None
+                            ? QString("Camera Viewer")
+                            : QString("Camera Viewer (%1)").arg(name));
+}
+
+/**
+ * Slot for new alerts, updates the alert list widget with the current sorting method.
+ * @param id The id of the alert.
+ */
+void MainWindow::onAlertRaised(const QString &id) {
+    Q_UNUSED(id);
+    onSortOptionChanged(comboBoxSortOptions->currentIndex());
+}
+
+/**
+ * Attaches to an engine running in another process.
+ * The frame ring is mapped read only and polled for new frames, and the
+ * alert socket is read as it receives data. Attaching does not add work to
+ * the engine, so any number of viewers can run at the same time.
+ *
+ * @return True if the frame ring could be mapped.
+ */
+bool MainWindow::attachToEngine() {
+    if (!ring.attach(engineHost::frameRingKey)) {
+        return false;
+    }
+
+    setCameras(ring.cameraCount());
+    displayedSequences.fill(0, ring.cameraCount());
+
+    // Subscribe to the alerts published from now on, dropping the oldest if this viewer falls behind
+    alertSocket = new QLocalSocket(this);
+    connect(alertSocket, &QLocalSocket::readyRead, this, &MainWindow::readAlertSocket);
+    connect(alertSocket, &QLocalSocket::connected, this, [this]() {
+        QJsonObject subscription;
+        subscription["policy"] = "drop-oldest";
+        subscription["queue"] = 256;
+
+        QJsonObject request;
+        request["subscribe"] = subscription;
+        alertSocket->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    });
+    alertSocket->connectToServer(engineHost::alertSocketName);
+
+    timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &MainWindow::readFrameRing);
+    timer->start(30);
+    return true;
+}
+
+/**
+ * Displays the frames published by the engine since the last poll.
+ * The image handed by the ring points into shared memory; it is scaled into
+ * the buffer of the camera kept between polls, as in showFrame, so only the
+ * pixmap for the label is created per frame.
+ */
+void MainWindow::readFrameRing() {
+    if (displayBuffers.size() < cameraLabels.size()) {
+        displayBuffers.resize(cameraLabels.size());
+    }
 
+    for (int i = 0; i < cameraLabels.size(); ++i) {
+        quint64 sequence = ring.latestSequence(i);
+        if (sequence == 0 || sequence == displayedSequences[i]) {
+            continue;
+        }
 
-            // Alert
-            displayAlert(alertLevelsAndTimes[i].first, i);
+        cv::Mat &display = displayBuffers[i];
+        int alertLevel = 0;
+        double scannedFraction = 1.0;
+        const QSize labelSize = cameraLabels[i]->size();
+
+        bool consistent = ring.read(i, [&](const QImage &image, const sharedFrameRing::frameInfo &info) {
+            const cv::Mat frame(image.height(), image.width(), CV_8UC3, const_cast<uchar *>(image.constBits()),
+                                image.bytesPerLine());
+            framePool::fitFrame(frame, cv::Size(labelSize.width(), labelSize.height()), display);
+            alertLevel = info.alertLevel;
+            scannedFraction = info.scannedFraction;
+        });
+
+        // Overwritten while reading, try again on the next poll
+        if (!consistent || display.empty()) {
+            continue;
+        }
 
-            // Convert cv::Mat to QImage
-            QImage image(
-                frame.data, frame.cols, frame.rows, frame.step, QImage::Format_RGB888);
+        displayedSequences[i] = sequence;
+        displayAlert(alertLevel, i);
+        displayCameraName(i, scannedFraction);
 
+        QImage image(display.data, display.cols, display.rows, display.step, QImage::Format_RGB888);
+        cameraLabels[i]->setPixmap(QPixmap::fromImage(image));
+    }
+}
 
-            // Display the camera name
-            cameraNameLabels[i]->setText(QString("CAM%1").arg(i));
+/**
+ * Reads the events of the alert stream, one JSON object per line, and adds
+ * the new alerts (or updates the merged ones) in the list of this viewer.
+ * @see alertStream::publish
+ */
+void MainWindow::readAlertSocket() {
+    bool changed = false;
 
+    while (alertSocket->canReadLine()) {
+        QJsonObject line = QJsonDocument::fromJson(alertSocket->readLine()).object();
 
-            // Set the image to the QLabel
-            cameraLabels[i]->setPixmap(QPixmap::fromImage(image).scaled(
-                cameraLabels[i]->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        if (line.contains("gap")) {
+            qWarning() << "Se perdieron alertas del motor:" << line["gap"].toObject();
+            continue;
         }
+
+        QJsonObject event = line["event"].toObject();
+        QString id = event["id"].toString();
+        if (id.isEmpty()) {
+            continue;
+        }
+
+        // Alerts and merges carry the whole record, so one missed (after a gap or
+        // before subscribing) still leaves the count of the engine
+        if (event["type"].toString() == "remove") {
+            viewerAlerts.removeAlerted(id);
+        } else {
+            viewerAlerts.insertAlerted(id, event["imgPath"].toString(),
+                                       QDate::fromString(event["date"].toString(), Qt::ISODate),
+                                       QTime::fromString(event["hour"].toString(), Qt::ISODate),
+                                       event["camera"].toInt(), event["occurrences"].toInt(1));
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        onSortOptionChanged(comboBoxSortOptions->currentIndex());
     }
-    objects.removePastObjects(currentTime);
 }
 
 void MainWindow::closeEvent(QCloseEvent *event) {
@@ -401,7 +619,10 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 
     // If the user clicks "Yes", save the alerts and accept the close event
     if (resBtn == QMessageBox::Yes) {
-        alerts.saveAlerts("../../data/alerts.json");
+        // In viewer mode the alerts belong to the engine process
+        if (host) {
+            host->saveAlerts();
+        }
         event->accept();
     } else {
         event->ignore();
@@ -2,13 +2,15 @@
 #define MAINWINDOW_H
 
 #include "ui_mainwindow.h"
-#include "indetectionobjects.h"
 #include "alertedobjects.h"
+#include "enginehost.h"
+#include "sharedframering.h"
 
 #include <QMainWindow>
 #include <QGridLayout>
 #include <QLabel>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QQueue>
 #include <QHash>
 #include <QComboBox>
@@ -20,6 +22,11 @@
 #include <QMessageBox>
 #include <QCloseEvent>
 #include <QListWidget>
+#include <QLocalSocket>
+#include <QMenu>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QContextMenuEvent>
 
 #include <opencv2/opencv.hpp>
 
@@ -27,11 +34,19 @@ class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    MainWindow(QWidget *parent = nullptr, bool viewerMode = false);
     ~MainWindow();
 
+    void setRecordingDirectory(const QString &directory);
+
 private slots:
-    void updateFrames();
+    void showFrame(int index, const framePool::handle &frame, int alertLevel, double scannedFraction);
+    void showDegradation(int level, const QString &name);
+    void onAlertRaised(const QString &id);
+
+    // Viewer mode
+    void readFrameRing();
+    void readAlertSocket();
 
 public slots:
     void onSortOptionChanged(int index);
@@ -53,16 +68,22 @@ private:
     QListWidget *sidebarWidget;
     QListWidget *alertsWidget;
 
-    // Class instance to store the objects that are being detected
-    inDetectionObjects objects;
+    // Capture and detection loop, when it runs in this process
+    engineHost *host = nullptr;
 
-    // Class instance to store that have been detected
-    alertedObjects alerts;
-    QList<std::pair<int, QTime>> alertLevelsAndTimes;
+    // Class instance to store that have been detected (the engine's, or a copy in viewer mode)
+    alertedObjects *alerts;
+    alertedObjects viewerAlerts;
     QComboBox *comboBoxSortOptions;
 
-    // *Camera
-    QVector<cv::VideoCapture> cameras;
+    // Viewer mode: frames mapped from the engine process and its alert socket
+    sharedFrameRing ring;
+    QLocalSocket *alertSocket = nullptr;
+    QVector<quint64> displayedSequences;
+
+    // Region of interest being drawn on a camera label (-1 when not drawing)
+    int drawingCamera = -1;
+    std::vector<cv::Point2f> drawingPolygon;
 
     // *Text
     QLabel *titleLabel;
@@ -71,28 +92,28 @@ private:
     QVector<QLabel*> cameraLabels;
     QVector<QLabel*> cameraNameLabels;
     QVector<QComboBox *> camerasOptions;
+    QVector<cv::Mat> displayBuffers; // Frames scaled to their label, reused between ticks
 
     // Extra
     QSpacerItem *topSpacer;
     QSpacerItem *bottomSpacer;
-    QTimer *timer;
-
-    // OpenCV
-    cv::CascadeClassifier faceCascade;
-    cv::HOGDescriptor pedestrianHOG;
-    bool usingHog = false;
+    QTimer *timer = nullptr;
 
     // Organization functions
     void createUI();
-    void setCameras();
-    void loadDetector(bool pedestrian);
+    void setCameras(int cameraCount);
+    bool attachToEngine();
     void displayAlert(int val, int index);
+    void displayCameraName(int index, double scannedFraction);
     void closeEvent(QCloseEvent *event);
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
     // Helper fuctions
     void updateAlertedList(QList<alertedObjects::alerted>);
     void onItemClicked(QListWidgetItem *item);
     void displayImage(QString &imgPath);
+    void drawRegions(QPixmap &pixmap, int index);
+    bool labelToFrame(int index, const QPoint &position, cv::Point2f &normalized);
 
 };
 #endif // MAINWINDOW_H
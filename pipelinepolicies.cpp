@@ -0,0 +1,97 @@
+#include "pipelinepolicies.h"
+
+#include <QDebug>
+
+/**
+ * Loads the Haar Cascade classifier for face detection.
+ * If the load fails, prints an error message to the console.
+ * @param profile The parameters used for every detection.
+ * @return True if the classifier was loaded.
+ */
+bool haarDetector::load(const detectorProfile &profile) {
+    this->profile = profile;
+    if (!cascade.load("../../cascades/haarcascade_frontalface_default.xml")) { // Two orders above build folder
+        qDebug() << "Error loading face cascade classifier.";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Loads the default people detector of OpenCV into the HOG descriptor.
+ * @param profile The parameters used for every detection.
+ * @return True, the detector is built into OpenCV.
+ */
+bool hogDetector::load(const detectorProfile &profile) {
+    this->profile = profile;
+    hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+    return true;
+}
+
+/**
+ * Handles an alert raised by the pipeline.
+ * If its crop is a near-duplicate of a recent alert of the camera it is merged
+ * into that alert. Otherwise the snapshot is saved to the data/img directory,
+ * as configured by the snapshot policy, and the alert is added to the alerts container.
+ *
+ * @param camera The index of the camera.
+ * @param id The id of the tracked object.
+ * @param frame The RGB frame, with the detections already drawn.
+ * @param detected The rectangle of the object.
+ * @param timestampMs The timestamp of the frame.
+ * @param wallTime The wall time of the frame.
+ * @param result The result of the frame, where the alert id is stored.
+ */
+void snapshotSink::onAlert(int camera, const QString &id, const cv::Mat &frame, const cv::Rect &detected,
+                           qint64 timestampMs, const QDateTime &wallTime, frameResult &result) {
+    // Hash the inside of the drawn rectangle to look for a recent duplicate
+    cv::Rect crop = cv::Rect(detected.x + 2, detected.y + 2, detected.width - 4, detected.height - 4) & cv::Rect(0, 0, frame.cols, frame.rows);
+    quint64 hash = snapshotDeduplicator::dHash(frame(crop));
+    QString duplicateId = context->deduplicator.findDuplicate(camera, hash, timestampMs);
+
+    if (!duplicateId.isEmpty() && context->alerts->mergeAlerted(duplicateId)) {
+        // Same object as a recent alert, no new file nor entry
+        result.alertId = duplicateId;
+        result.merged = true;
+        return;
+    }
+
+    QString basePath = QString("../../data/img/%1").arg(id);
+    QString imgPath = QString("%1.%2").arg(basePath, context->writer.getPolicy().extension());
+
+    // Save the image (full frame or crop, with the configured encoder)
+    if (context->saveSnapshots) {
+        QString written = context->writer.write(frame, detected, basePath);
+        if (!written.isEmpty()) {
+            imgPath = written;
+        }
+    }
+
+    // Add the alert (class alertedObjects)
+    context->alerts->insertAlerted(id, imgPath, wallTime.date(), wallTime.time(), camera);
+    context->deduplicator.addAlert(camera, hash, id, timestampMs);
+    result.alertId = id;
+}
+
+/**
+ * Builds the pipeline instantiation for a detector profile.
+ * The detector kind is only checked here; the returned pipeline runs without
+ * branching on it for every frame.
+ *
+ * @param profile The detector and its parameters.
+ * @param context The alert state shared with the engine.
+ * @return The pipeline, ready to process frames.
+ */
+std::unique_ptr<pipelineBase> makePipeline(const detectorProfile &profile, alertContext *context) {
+    if (profile.pedestrian) {
+        hogDetector detector;
+        detector.load(profile);
+        return std::make_unique<detectionPipeline<hogDetector, ruleTracker, snapshotSink>>(
+            std::move(detector), ruleTracker(), snapshotSink(context));
+    }
+
+    haarDetector detector;
+    detector.load(profile);
+    return std::make_unique<detectionPipeline<haarDetector, ruleTracker, snapshotSink>>(
+        std::move(detector), ruleTracker(), snapshotSink(context));
+}
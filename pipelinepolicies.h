@@ -0,0 +1,74 @@
+#ifndef PIPELINEPOLICIES_H
+#define PIPELINEPOLICIES_H
+
+#include "detectionpipeline.h"
+#include "detectorprofile.h"
+#include "ruletracker.h"
+#include "alertedobjects.h"
+#include "snapshotdeduplicator.h"
+#include "snapshotwriter.h"
+
+#include <memory>
+
+// Detector policy with the Haar cascade for faces
+class haarDetector
+{
+public:
+    bool load(const detectorProfile &profile);
+
+    // The scores are the weights of the last stage of the cascade
+    void detect(const cv::Mat &input, std::vector<cv::Rect> &detections, std::vector<double> &scores, double scale) {
+        int minSide = static_cast<int>(profile.minSize * scale);
+        cascade.detectMultiScale(input, detections, rejectLevels, scores, profile.scaleFactor, profile.minNeighbors, 0,
+                                 cv::Size(minSide, minSide), cv::Size(), true);
+    }
+
+private:
+    cv::CascadeClassifier cascade;
+    detectorProfile profile;
+    std::vector<int> rejectLevels;
+};
+
+// Detector policy with the HOG + SVM people detector
+class hogDetector
+{
+public:
+    bool load(const detectorProfile &profile);
+
+    // The scores are the SVM weights of the detections
+    void detect(const cv::Mat &input, std::vector<cv::Rect> &detections, std::vector<double> &scores, double) {
+        hog.detectMultiScale(input, detections, scores, 0, cv::Size(profile.winStride, profile.winStride),
+                             cv::Size(profile.padding, profile.padding), profile.hogScale);
+    }
+
+private:
+    cv::HOGDescriptor hog;
+    detectorProfile profile;
+};
+
+// State shared by the sinks of every pipeline the engine builds
+struct alertContext
+{
+    alertedObjects *alerts = nullptr;
+    snapshotWriter writer;
+    snapshotDeduplicator deduplicator; // Index of recent alert crops, to merge near-duplicate alerts
+    bool saveSnapshots = true;
+};
+
+// Sink policy that merges duplicates, writes the snapshot and records the alert
+class snapshotSink
+{
+public:
+    explicit snapshotSink(alertContext *context) : context(context) {}
+
+    void onAlert(int camera, const QString &id, const cv::Mat &frame, const cv::Rect &detected,
+                 qint64 timestampMs, const QDateTime &wallTime, frameResult &result);
+
+private:
+    alertContext *context;
+};
+
+// Builds the pipeline for a detector profile, the only place where the detector kind is checked
+std::unique_ptr<pipelineBase> makePipeline(const detectorProfile &profile, alertContext *context);
+
+#endif // PIPELINEPOLICIES_H
@@ -0,0 +1,227 @@
+#include "regionofinterest.h"
+
+#include <algorithm>
+
+/**
+ * Adds a polygon to the region.
+ * @param polygon The vertices, normalized to [0, 1]; polygons with less than 3 vertices are ignored.
+ * @param id The id of the polygon, or -1 for the next unused one (also given when the id is taken).
+ * @return The id of the polygon, or -1 if it was ignored.
+ */
+int regionOfInterest::addPolygon(const std::vector<cv::Point2f> &polygon, int id) {
+    if (polygon.size() < 3) {
+        return -1;
+    }
+
+    if (id < 0 || std::find(ids.begin(), ids.end(), id) != ids.end()) {
+        id = nextId;
+    }
+    nextId = qMax(nextId, id + 1);
+    polygons.push_back(polygon);
+    ids.push_back(id);
+    return id;
+}
+
+/**
+ * Removes every polygon, so the whole frame is scanned again.
+ * The ids are not reused, so a rule on a removed zone does not move to a new polygon.
+ */
+void regionOfInterest::clear() {
+    polygons.clear();
+    ids.clear();
+}
+
+/**
+ * Checks if the region has no polygons (the whole frame is of interest).
+ */
+bool regionOfInterest::isEmpty() const {
+    return polygons.empty();
+}
+
+/**
+ * Returns the polygons of the region, normalized to [0, 1].
+ */
+const std::vector<std::vector<cv::Point2f>> &regionOfInterest::getPolygons() const {
+    return polygons;
+}
+
+/**
+ * Returns the id of each polygon, in the order of getPolygons.
+ */
+const std::vector<int> &regionOfInterest::getIds() const {
+    return ids;
+}
+
+/**
+ * Returns the id that the next polygon will get.
+ */
+int regionOfInterest::getNextId() const {
+    return nextId;
+}
+
+/**
+ * Raises the id of the next polygon, restored from the settings so that the
+ * ids of removed polygons are not given again after a restart.
+ * @param id The lowest id the next polygon can get.
+ */
+void regionOfInterest::setNextId(int id) {
+    nextId = qMax(nextId, id);
+}
+
+/**
+ * Returns the rectangles of the frame where the detector has to run.
+ * They are the bounding boxes of the polygons, with overlapping boxes merged
+ * so no pixel is scanned twice. Without polygons, it is the whole frame.
+ *
+ * @param frameSize The size of the frame in pixels.
+ * @return The rectangles to crop, in frame coordinates.
+ */
+std::vector<cv::Rect> regionOfInterest::cropRects(const cv::Size &frameSize) const {
+    cv::Rect frameRect(cv::Point(0, 0), frameSize);
+    if (polygons.empty()) {
+        return {frameRect};
+    }
+
+    std::vector<cv::Rect> rects;
+    for (const auto &polygon : polygons) {
+        cv::Rect rect = cv::boundingRect(toPixels(polygon, frameSize)) & frameRect;
+        if (!rect.empty()) {
+            rects.push_back(rect);
+        }
+    }
+
+    // Merge overlapping rectangles until none overlap
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                if (!(rects[i] & rects[j]).empty()) {
+                    rects[i] |= rects[j];
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return rects;
+}
+
+/**
+ * Checks if a detection belongs to the region, using the center of its rectangle.
+ * @param detection The detection, in frame coordinates.
+ * @param frameSize The size of the frame in pixels.
+ * @return True if the center lies inside any polygon, or if there are no polygons.
+ */
+bool regionOfInterest::contains(const cv::Rect &detection, const cv::Size &frameSize) const {
+    if (polygons.empty()) {
+        return true;
+    }
+
+    cv::Point2f center(detection.x + detection.width / 2.0f, detection.y + detection.height / 2.0f);
+    for (const auto &polygon : polygons) {
+        if (cv::pointPolygonTest(toPixels(polygon, frameSize), center, false) >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Checks if the center of a detection falls inside one polygon, as the zones of the alert rules.
+ * The center is normalized instead of the polygon converted to pixels, so nothing is allocated.
+ * @param id The id of the polygon.
+ * @param detection The detection, in frame coordinates.
+ * @param frameSize The size of the frame in pixels.
+ * @return False if there is no polygon with that id.
+ */
+bool regionOfInterest::polygonContains(int id, const cv::Rect &detection, const cv::Size &frameSize) const {
+    auto found = std::find(ids.begin(), ids.end(), id);
+    if (found == ids.end() || frameSize.width <= 0 || frameSize.height <= 0) {
+        return false;
+    }
+    const auto &polygon = polygons[found - ids.begin()];
+
+    cv::Point2f center((detection.x + detection.width / 2.0f) / frameSize.width,
+                       (detection.y + detection.height / 2.0f) / frameSize.height);
+    return cv::pointPolygonTest(polygon, center, false) >= 0;
+}
+
+/**
+ * Returns the fraction of the frame pixels scanned by the detector.
+ * @param frameSize The size of the frame in pixels.
+ * @return A value in [0, 1], 1 when there are no polygons.
+ */
+double regionOfInterest::scannedFraction(const cv::Size &frameSize) const {
+    if (frameSize.area() <= 0) {
+        return 1.0;
+    }
+
+    double scanned = 0;
+    for (const cv::Rect &rect : cropRects(frameSize)) {
+        scanned += rect.area();
+    }
+    return scanned / frameSize.area();
+}
+
+/**
+ * Builds a region from its JSON representation, an array of polygons where
+ * each polygon is an array of [x, y] pairs normalized to [0, 1].
+ * @param json The array of polygons.
+ * @return The region; malformed polygons are skipped.
+ */
+regionOfInterest regionOfInterest::fromJson(const QJsonArray &json) {
+    regionOfInterest region;
+
+    for (int i = 0; i < json.size(); i++) {
+        // Plain arrays of points come from before the ids, their index was the zone of the rules
+        const QJsonValue polygonValue = json[i];
+        const QJsonArray points = polygonValue.isObject() ? polygonValue.toObject()["points"].toArray() : polygonValue.toArray();
+        const int id = polygonValue.isObject() ? polygonValue.toObject()["id"].toInt(i) : i;
+
+        std::vector<cv::Point2f> polygon;
+        for (const QJsonValue &pointValue : points) {
+            QJsonArray point = pointValue.toArray();
+            if (point.size() == 2) {
+                polygon.emplace_back(static_cast<float>(qBound(0.0, point[0].toDouble(), 1.0)),
+                                     static_cast<float>(qBound(0.0, point[1].toDouble(), 1.0)));
+            }
+        }
+        region.addPolygon(polygon, qMax(0, id));
+    }
+
+    return region;
+}
+
+/**
+ * Converts the region to its JSON representation.
+ */
+QJsonArray regionOfInterest::toJson() const {
+    QJsonArray json;
+    for (size_t i = 0; i < polygons.size(); i++) {
+        QJsonArray points;
+        for (const cv::Point2f &point : polygons[i]) {
+            points.append(QJsonArray({point.x, point.y}));
+        }
+
+        QJsonObject polygonJson;
+        polygonJson["id"] = ids[i];
+        polygonJson["points"] = points;
+        json.append(polygonJson);
+    }
+    return json;
+}
+
+/**
+ * Converts a normalized polygon to pixel coordinates.
+ */
+std::vector<cv::Point> regionOfInterest::toPixels(const std::vector<cv::Point2f> &polygon, const cv::Size &frameSize) {
+    std::vector<cv::Point> pixels;
+    pixels.reserve(polygon.size());
+    for (const cv::Point2f &point : polygon) {
+        pixels.emplace_back(cvRound(point.x * frameSize.width), cvRound(point.y * frameSize.height));
+    }
+    return pixels;
+}
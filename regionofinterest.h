@@ -0,0 +1,45 @@
+#ifndef REGIONOFINTEREST_H
+#define REGIONOFINTEREST_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Class for the polygons of a camera where detection runs, in coordinates normalized to the frame size.
+// Each polygon keeps an id that is never reused, so the alert rules can name it as a zone
+class regionOfInterest
+{
+public:
+    // Polygon management
+    int addPolygon(const std::vector<cv::Point2f> &polygon, int id = -1);
+    void clear();
+    bool isEmpty() const;
+    const std::vector<std::vector<cv::Point2f>> &getPolygons() const;
+    const std::vector<int> &getIds() const;
+    int getNextId() const;
+    void setNextId(int id);
+
+    // Detection helpers
+    std::vector<cv::Rect> cropRects(const cv::Size &frameSize) const;
+    bool contains(const cv::Rect &detection, const cv::Size &frameSize) const;
+    bool polygonContains(int id, const cv::Rect &detection, const cv::Size &frameSize) const;
+    double scannedFraction(const cv::Size &frameSize) const;
+
+    // Serialization ([{"id": n, "points": [[x, y], ...]}, ...]; plain [[x, y], ...] polygons take their index as id)
+    static regionOfInterest fromJson(const QJsonArray &json);
+    QJsonArray toJson() const;
+
+private:
+    // Container
+    std::vector<std::vector<cv::Point2f>> polygons;
+    std::vector<int> ids; // Id of each polygon
+    int nextId = 0;
+
+    // Private helper functions
+    static std::vector<cv::Point> toPixels(const std::vector<cv::Point2f> &polygon, const cv::Size &frameSize);
+};
+
+#endif // REGIONOFINTEREST_H
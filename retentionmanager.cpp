@@ -0,0 +1,486 @@
+#include "retentionmanager.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QSet>
+#include <QDebug>
+
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Builds a budget from its JSON representation. Missing values are taken from the defaults.
+ * @param json The JSON object.
+ * @param defaults The budget that provides the missing values.
+ * @return The budget.
+ */
+retentionManager::budget retentionManager::budget::fromJson(const QJsonObject &json, const budget &defaults) {
+    budget b;
+
+    b.maxAgeDays = qMax(0, json["maxAgeDays"].toInt(defaults.maxAgeDays));
+    b.maxMegabytes = qMax(0, json["maxMegabytes"].toInt(defaults.maxMegabytes));
+    b.downsampleAfterDays = qMax(0, json["downsampleAfterDays"].toInt(defaults.downsampleAfterDays));
+    b.downsampleWidth = qMax(16, json["downsampleWidth"].toInt(defaults.downsampleWidth));
+    return b;
+}
+
+/**
+ * Converts the budget to its JSON representation.
+ */
+QJsonObject retentionManager::budget::toJson() const {
+    QJsonObject json;
+    json["maxAgeDays"] = maxAgeDays;
+    json["maxMegabytes"] = maxMegabytes;
+    json["downsampleAfterDays"] = downsampleAfterDays;
+    json["downsampleWidth"] = downsampleWidth;
+    return json;
+}
+
+/**
+ * Builds the policy from the "retention" section of the settings, with its
+ * "default" budget, and the "retention" object of each camera in the
+ * "cameras" section, whose missing values are taken from the default budget.
+ *
+ * @param retention The "retention" section.
+ * @param cameras The "cameras" section.
+ * @return The policy.
+ */
+retentionManager::policy retentionManager::policy::fromJson(const QJsonObject &retention, const QJsonObject &cameras) {
+    policy p;
+
+    p.enabled = retention["enabled"].toBool(p.enabled);
+    p.intervalMinutes = qMax(1, retention["intervalMinutes"].toInt(p.intervalMinutes));
+    p.batchSize = qMax(1, retention["batchSize"].toInt(p.batchSize));
+    p.stepDelayMs = qMax(0, retention["stepDelayMs"].toInt(p.stepDelayMs));
+    p.orphanGraceMinutes = qMax(1, retention["orphanGraceMinutes"].toInt(p.orphanGraceMinutes));
+    p.defaults = budget::fromJson(retention["default"].toObject(), p.defaults);
+
+    for (auto it = cameras.constBegin(); it != cameras.constEnd(); ++it) {
+        bool ok = false;
+        int camera = it.key().toInt(&ok);
+        QJsonObject cameraRetention = it.value().toObject()["retention"].toObject();
+        if (ok && !cameraRetention.isEmpty()) {
+            p.cameras.insert(camera, budget::fromJson(cameraRetention, p.defaults));
+        }
+    }
+    return p;
+}
+
+/**
+ * Returns the budget of a camera, or the default one if it has no override.
+ * @param camera The index of the camera.
+ */
+retentionManager::budget retentionManager::policy::forCamera(int camera) const {
+    return cameras.value(camera, defaults);
+}
+
+/**
+ * Constructor for retentionManager.
+ * The worker is moved to a thread that only starts with start().
+ * @param alerts The alerts whose records are pruned, owned by the caller's thread.
+ * @param imageDir The directory of the snapshots (e.g. data/img).
+ * @param parent The parent QObject.
+ */
+retentionManager::retentionManager(alertedObjects *alerts, const QString &imageDir, QObject *parent)
+    : QObject(parent), alerts(alerts), imageDir(imageDir) {
+    worker = new retentionWorker(this, imageDir);
+    worker->moveToThread(&thread);
+
+    timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &retentionManager::runPass);
+}
+
+/**
+ * Destructor for retentionManager.
+ * Stops the worker thread; a pass in progress is abandoned between two steps
+ * and resumes from scratch next time, which is safe since records are always
+ * pruned before their files are deleted.
+ */
+retentionManager::~retentionManager() {
+    thread.quit();
+    thread.wait();
+    delete worker;
+}
+
+/**
+ * Sets the budgets and the pace of the passes.
+ * @param retentionPolicy The policy, usually read from the settings.
+ * @see policy::fromJson
+ */
+void retentionManager::configure(const policy &retentionPolicy) {
+    this->retentionPolicy = retentionPolicy;
+    if (timer->isActive()) {
+        timer->start(retentionPolicy.intervalMinutes * 60000);
+    }
+}
+
+/**
+ * Starts the worker thread at the lowest priority and schedules the passes.
+ * The first pass runs shortly after, once the cameras are running.
+ */
+void retentionManager::start() {
+    if (!retentionPolicy.enabled || thread.isRunning()) {
+        return;
+    }
+
+    thread.start(QThread::IdlePriority);
+    timer->start(retentionPolicy.intervalMinutes * 60000);
+    QTimer::singleShot(30000, this, &retentionManager::runPass);
+}
+
+/**
+ * Starts a retention pass over a copy of the current records, unless one is
+ * still running. The worker plans and performs the file work on its thread.
+ */
+void retentionManager::runPass() {
+    if (passRunning || !thread.isRunning()) {
+        return;
+    }
+
+    QList<record> records;
+    const QMap<QString, alertedObjects::alerted> current = alerts->getAlerted();
+    for (auto it = current.cbegin(); it != current.cend(); ++it) {
+        records.append({it.key(), it.value().imgPath, it.value().camera, QDateTime(it.value().date, it.value().hour)});
+    }
+
+    passRunning = true;
+    retentionWorker *target = worker;
+    policy passPolicy = retentionPolicy;
+    QMetaObject::invokeMethod(worker, [target, records, passPolicy]() {
+        target->startPass(records, passPolicy);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * Removes the expired records and lets the worker delete their files.
+ * Runs on the thread of the alerts, so the records (and, through
+ * alertsRemoved, the saved alerts file) never point to deleted files.
+ * @param ids The ids of the expired alerts.
+ */
+void retentionManager::expire(const QStringList &ids) {
+    for (const QString &id : ids) {
+        alerts->removeAlerted(id);
+    }
+    emit alertsRemoved(ids);
+
+    retentionWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target, ids]() {
+        target->removeExpired(ids);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * Closes a pass, reporting what it did.
+ */
+void retentionManager::passDone(int downsampled, int expired, int orphans) {
+    passRunning = false;
+    if (downsampled + expired + orphans > 0) {
+        qDebug() << "Retention pass:" << downsampled << "downsampled," << expired << "expired," << orphans << "orphans removed";
+    }
+    emit passFinished(downsampled, expired, orphans);
+}
+
+/**
+ * Constructor for retentionWorker.
+ * @param manager The manager that owns the records.
+ * @param imageDir The directory of the snapshots.
+ */
+retentionWorker::retentionWorker(retentionManager *manager, const QString &imageDir)
+    : manager(manager), imageDir(imageDir) {}
+
+/**
+ * Starts a pass over the given records. Nothing is read here: the image
+ * directory and the records are visited by the following steps.
+ * @param records The alert records when the pass started.
+ * @param passPolicy The budgets for this pass.
+ */
+void retentionWorker::startPass(const QList<retentionManager::record> &records, const retentionManager::policy &passPolicy) {
+    this->passPolicy = passPolicy;
+    pending.clear();
+    awaitingPrune.clear();
+    measuredRecords.clear();
+    downsampled = expired = orphans = 0;
+
+    passStart = QDateTime::currentDateTime();
+    passRecords = records;
+    std::sort(passRecords.begin(), passRecords.end(), [](const retentionManager::record &a, const retentionManager::record &c) {
+        return a.camera != c.camera ? a.camera < c.camera : a.time < c.time;
+    });
+    known.clear();
+    for (const retentionManager::record &alert : passRecords) {
+        known.insert(alert.id);
+    }
+
+    scan.reset(new QDirIterator(imageDir, QDir::Files));
+    current = Scanning;
+    scheduleNext();
+}
+
+/**
+ * Deletes the files of records that the manager has already pruned, and
+ * continues with the pass.
+ * @param ids The ids of the pruned records.
+ */
+void retentionWorker::removeExpired(const QStringList &ids) {
+    for (const QString &id : ids) {
+        for (const QString &file : awaitingPrune.take(id)) {
+            QFile::remove(file);
+        }
+        expired++;
+    }
+    scheduleNext();
+}
+
+/**
+ * Plans the next batch of the pass, with at most batchSize files or records.
+ *
+ * Scanning visits the image directory: files that no record references are
+ * orphans, and are deleted once they are older than the grace period (a
+ * snapshot is written just before its record is inserted). Measuring then
+ * stats the files of each record and, for those older than
+ * downsampleAfterDays, the width of the snapshot. Once every record is
+ * measured the actions are decided, without touching the disk.
+ */
+void retentionWorker::plan() {
+    if (current == Scanning) {
+        const qint64 graceSecs = qint64(passPolicy.orphanGraceMinutes) * 60;
+
+        // Orphan files (thumbnails belong to the id of their snapshot)
+        for (int done = 0; done < passPolicy.batchSize && scan->hasNext(); done++) {
+            scan->next();
+            const QFileInfo info = scan->fileInfo();
+            QString id = info.completeBaseName();
+            if (id.endsWith("_thumb")) {
+                id.chop(6);
+            }
+            if (!known.contains(id) && info.lastModified().secsTo(passStart) > graceSecs) {
+                pending.enqueue({action::DeleteOrphan, id, {info.filePath()}});
+            }
+        }
+
+        if (!scan->hasNext()) {
+            scan.reset();
+            current = Measuring;
+        }
+        return;
+    }
+
+    const int end = qMin(measuredRecords.size() + passPolicy.batchSize, passRecords.size());
+    for (int i = measuredRecords.size(); i < end; i++) {
+        measuredRecords.append(measure(passRecords[i]));
+    }
+
+    if (measuredRecords.size() == passRecords.size()) {
+        decide();
+        current = Performing;
+    }
+}
+
+/**
+ * Decides the actions of the pass from the measured records. For each camera,
+ * from the oldest alert: records without a snapshot, records older than
+ * maxAgeDays and, while the snapshots of the camera exceed maxMegabytes, the
+ * oldest records are expired. The remaining snapshots wider than
+ * downsampleWidth are downsampled.
+ */
+void retentionWorker::decide() {
+    const qint64 graceSecs = qint64(passPolicy.orphanGraceMinutes) * 60;
+
+    QList<action> downsamples;
+    for (int first = 0; first < measuredRecords.size();) {
+        const int camera = measuredRecords[first].alert.camera;
+        const retentionManager::budget b = passPolicy.forCamera(camera);
+        const qint64 maxBytes = qint64(b.maxMegabytes) * 1024 * 1024;
+
+        int last = first;
+        qint64 total = 0;
+        while (last < measuredRecords.size() && measuredRecords[last].alert.camera == camera) {
+            total += measuredRecords[last].size;
+            last++;
+        }
+
+        for (int i = first; i < last; i++) {
+            const measured &m = measuredRecords[i];
+            double ageDays = m.alert.time.secsTo(passStart) / 86400.0;
+
+            bool missing = m.missing && m.alert.time.secsTo(passStart) > graceSecs;
+            bool tooOld = b.maxAgeDays > 0 && ageDays > b.maxAgeDays;
+            bool overBudget = b.maxMegabytes > 0 && total > maxBytes;
+
+            if (missing || tooOld || overBudget) {
+                pending.enqueue({action::Expire, m.alert.id, m.files});
+                knownWidths.remove(m.alert.id);
+                total -= m.size;
+            } else if (m.width > 0) {
+                downsamples.append({action::Downsample, m.alert.id, {m.alert.path}, m.width});
+            }
+        }
+        first = last;
+    }
+
+    // Space is freed first, then the remaining old snapshots are shrunk
+    for (const action &a : downsamples) {
+        pending.enqueue(a);
+    }
+
+    // Widths of alerts removed by other means are not needed anymore
+    for (auto it = knownWidths.begin(); it != knownWidths.end();) {
+        if (known.contains(it.key())) {
+            ++it;
+        } else {
+            it = knownWidths.erase(it);
+        }
+    }
+    measuredRecords.clear();
+    passRecords.clear();
+    known.clear();
+}
+
+/**
+ * Plans or performs one batch of the pass. Up to batchSize actions are
+ * performed per step. Expired records are sent to the manager in one batch
+ * and their files are only deleted when it confirms, in removeExpired;
+ * otherwise the next step is scheduled after stepDelayMs.
+ */
+void retentionWorker::step() {
+    if (current == Scanning || current == Measuring) {
+        plan();
+        scheduleNext();
+        return;
+    }
+
+    QStringList expiredIds;
+
+    for (int done = 0; done < passPolicy.batchSize && !pending.isEmpty(); done++) {
+        action a = pending.dequeue();
+
+        switch (a.type) {
+        case action::Expire:
+            expiredIds.append(a.id);
+            awaitingPrune.insert(a.id, a.files);
+            break;
+        case action::Downsample:
+            if (downsample(a.files.first(), a.width)) {
+                knownWidths.insert(a.id, a.width);
+                downsampled++;
+            }
+            break;
+        case action::DeleteOrphan:
+            if (QFile::remove(a.files.first())) {
+                orphans++;
+            }
+            break;
+        }
+    }
+
+    if (!expiredIds.isEmpty()) {
+        retentionManager *target = manager;
+        QMetaObject::invokeMethod(manager, [target, expiredIds]() {
+            target->expire(expiredIds);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    scheduleNext();
+}
+
+/**
+ * Schedules the next step of the pass, or reports the end of the pass.
+ */
+void retentionWorker::scheduleNext() {
+    if (current == Performing && pending.isEmpty() && awaitingPrune.isEmpty()) {
+        current = Idle;
+        retentionManager *target = manager;
+        int d = downsampled, e = expired, o = orphans;
+        QMetaObject::invokeMethod(manager, [target, d, e, o]() {
+            target->passDone(d, e, o);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    if (awaitingPrune.isEmpty()) {
+        QTimer::singleShot(passPolicy.stepDelayMs, this, &retentionWorker::step);
+    }
+}
+
+/**
+ * Measures an alert: its files (the snapshot and, if present, its thumbnail)
+ * and their size, as it will be once downsampled. The width of a snapshot is
+ * only read from its header the first time it is old enough to be shrunk;
+ * after that, and once it is downsampled, the known width is used.
+ * @param alert The alert record.
+ * @return The measured record.
+ */
+retentionWorker::measured retentionWorker::measure(const retentionManager::record &alert) {
+    measured m;
+    m.alert = alert;
+
+    const QFileInfo snapshot(alert.path);
+    const QFileInfo thumbnail(snapshot.dir().filePath(alert.id + "_thumb.jpg"));
+    for (const QFileInfo &info : {snapshot, thumbnail}) {
+        if (info.exists()) {
+            m.files.append(info.filePath());
+            m.size += info.size();
+        }
+    }
+    m.missing = !snapshot.exists();
+
+    const retentionManager::budget b = passPolicy.forCamera(alert.camera);
+    double ageDays = alert.time.secsTo(passStart) / 86400.0;
+    if (m.missing || b.downsampleAfterDays <= 0 || ageDays <= b.downsampleAfterDays) {
+        return m;
+    }
+
+    auto cached = knownWidths.constFind(alert.id);
+    int width = cached != knownWidths.constEnd() ? *cached : QImageReader(alert.path).size().width();
+    if (width <= 0) {
+        return m;
+    }
+    knownWidths.insert(alert.id, width);
+
+    if (width > b.downsampleWidth) {
+        double ratio = double(b.downsampleWidth) / width;
+        m.size = qint64(m.size * ratio * ratio);
+        m.width = b.downsampleWidth;
+    }
+    return m;
+}
+
+/**
+ * Shrinks a snapshot to the given width, keeping its format. The new file is
+ * written aside and replaces the old one atomically, so a reader never sees a
+ * partial image.
+ * @param path The snapshot.
+ * @param width The new width.
+ * @return True if the snapshot was replaced.
+ */
+bool retentionWorker::downsample(const QString &path, int width) {
+    cv::Mat image = cv::imread(path.toStdString(), cv::IMREAD_UNCHANGED);
+    if (image.empty() || image.cols <= width) {
+        return false;
+    }
+
+    cv::Mat small;
+    double scale = double(width) / image.cols;
+    cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+
+    std::vector<uchar> buffer;
+    try {
+        if (!cv::imencode("." + QFileInfo(path).suffix().toStdString(), small, buffer)) {
+            return false;
+        }
+    } catch (const cv::Exception &e) {
+        qWarning() << "Error del codificador:" << e.what();
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "No se pudo guardar el archivo:" << path;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<qint64>(buffer.size()));
+    return file.commit();
+}
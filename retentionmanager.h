@@ -0,0 +1,157 @@
+#ifndef RETENTIONMANAGER_H
+#define RETENTIONMANAGER_H
+
+#include "alertedobjects.h"
+
+#include <QObject>
+#include <QDirIterator>
+#include <QThread>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QJsonObject>
+
+#include <memory>
+
+class retentionWorker;
+
+// Class that keeps the alert snapshots and records within their per-camera budgets, from a low priority thread
+class retentionManager : public QObject {
+    Q_OBJECT
+
+public:
+    // Struct for the budget of a camera (0 disables a limit)
+    struct budget
+    {
+        int maxAgeDays = 30;          // Alerts older than this are removed
+        int maxMegabytes = 512;       // Snapshots of the camera above this size are removed, oldest first
+        int downsampleAfterDays = 7;  // Snapshots older than this are shrunk to downsampleWidth
+        int downsampleWidth = 320;
+
+        static budget fromJson(const QJsonObject &json, const budget &defaults);
+        QJsonObject toJson() const;
+    };
+
+    // Struct for the retention options
+    struct policy
+    {
+        bool enabled = false;         // Opt-in, since it deletes data
+        int intervalMinutes = 10;     // Time between passes
+        int batchSize = 8;            // Files handled per step of a pass
+        int stepDelayMs = 250;        // Pause between steps, so the frame loop keeps the disk
+        int orphanGraceMinutes = 60;  // Unreferenced files younger than this are left alone
+        budget defaults;
+        QHash<int, budget> cameras;   // Overrides from the "retention" object of each camera
+
+        static policy fromJson(const QJsonObject &retention, const QJsonObject &cameras);
+        budget forCamera(int camera) const;
+    };
+
+    // Struct for an alert record, as seen by a pass
+    struct record
+    {
+        QString id;
+        QString path;
+        int camera;
+        QDateTime time;
+    };
+
+    retentionManager(alertedObjects *alerts, const QString &imageDir, QObject *parent = nullptr);
+    ~retentionManager();
+
+    void configure(const policy &retentionPolicy);
+    void start();
+
+public slots:
+    void runPass();
+
+signals:
+    // Emitted once the records are pruned, before their files are deleted
+    void alertsRemoved(const QStringList &ids);
+    void passFinished(int downsampled, int expired, int orphans);
+
+private:
+    friend class retentionWorker;
+
+    alertedObjects *alerts;
+    QString imageDir;
+    policy retentionPolicy;
+
+    QThread thread;
+    retentionWorker *worker;
+    QTimer *timer;
+    bool passRunning = false;
+
+    // Called by the worker, on the thread of the manager
+    void expire(const QStringList &ids);
+    void passDone(int downsampled, int expired, int orphans);
+};
+
+// Class that plans and performs the file work of a retention pass, living in the thread of the manager
+class retentionWorker : public QObject {
+    Q_OBJECT
+
+public:
+    retentionWorker(retentionManager *manager, const QString &imageDir);
+
+    void startPass(const QList<retentionManager::record> &records, const retentionManager::policy &passPolicy);
+    void removeExpired(const QStringList &ids);
+
+private:
+    // Struct for a planned action
+    struct action
+    {
+        enum kind { Expire, Downsample, DeleteOrphan };
+
+        kind type;
+        QString id;
+        QStringList files;
+        int width = 0; // Target width when downsampling
+    };
+
+    // Struct for a record measured while planning, with what its snapshot will take on disk
+    struct measured
+    {
+        retentionManager::record alert;
+        QStringList files;
+        qint64 size = 0;      // Estimated at the downsampled width when it is shrunk
+        int width = 0;        // Target width when downsampling, 0 to leave it as is
+        bool missing = false; // No snapshot on disk
+    };
+
+    // Stage of a pass; every stage but Idle advances by one batch per step
+    enum stage { Idle, Scanning, Measuring, Performing };
+
+    retentionManager *manager;
+    QString imageDir;
+    retentionManager::policy passPolicy;
+
+    stage current = Idle;
+    QDateTime passStart;
+    QList<retentionManager::record> passRecords; // By camera, oldest first
+    QSet<QString> known;                         // Ids of passRecords, to tell orphan files
+    std::unique_ptr<QDirIterator> scan;          // Files of the image directory still to visit
+    QList<measured> measuredRecords;
+    QHash<QString, int> knownWidths; // Snapshot widths read or downsampled, kept between passes
+
+    QQueue<action> pending;
+    QHash<QString, QStringList> awaitingPrune; // Files of expired records, deleted once the records are gone
+    int downsampled = 0;
+    int expired = 0;
+    int orphans = 0;
+
+    // Private helper functions
+    void plan();
+    void decide();
+    void step();
+    void scheduleNext();
+    measured measure(const retentionManager::record &alert);
+    static bool downsample(const QString &path, int width);
+};
+
+#endif // RETENTIONMANAGER_H
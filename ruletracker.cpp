@@ -0,0 +1,417 @@
+#include "ruletracker.h"
+
+#include <cstdlib>
+
+/**
+ * Builds a rule from its JSON representation. Missing values keep the defaults.
+ * @param json The JSON object.
+ * @return The rule.
+ */
+ruleTracker::rule ruleTracker::rule::fromJson(const QJsonObject &json) {
+    rule r;
+
+    r.name = json["name"].toString(r.name);
+    r.zone = qMax(-1, json["zone"].toInt(r.zone));
+    r.dwellS = qMax(0, json["dwellS"].toInt(r.dwellS));
+    r.count = qMax(1, json["count"].toInt(r.count));
+    r.cooldownS = qMax(0, json["cooldownS"].toInt(r.cooldownS));
+    return r;
+}
+
+/**
+ * Builds the policy from the "rules" section of the settings, with its
+ * "default" rules, and the "rules" array of each camera in the "cameras"
+ * section, which replaces the default rules for that camera.
+ *
+ * @param rules The "rules" section.
+ * @param cameras The "cameras" section.
+ * @return The policy.
+ */
+ruleTracker::policy ruleTracker::policy::fromJson(const QJsonObject &rules, const QJsonObject &cameras) {
+    policy p;
+
+    p.tolerance = qMax(0, rules["tolerance"].toInt(p.tolerance));
+    p.confirmAfterS = qMax(0, rules["confirmAfterS"].toInt(p.confirmAfterS));
+    p.expireAfterS = qMax(0, rules["expireAfterS"].toInt(p.expireAfterS));
+    p.maxExpiriesPerTick = qMax(1, rules["maxExpiriesPerTick"].toInt(p.maxExpiriesPerTick));
+
+    auto rulesOf = [](const QJsonArray &array) {
+        QList<rule> list;
+        for (const QJsonValue &value : array) {
+            list.append(rule::fromJson(value.toObject()));
+        }
+        return list;
+    };
+
+    if (rules["default"].isArray()) {
+        p.defaults = rulesOf(rules["default"].toArray());
+    }
+
+    for (auto it = cameras.constBegin(); it != cameras.constEnd(); ++it) {
+        bool ok = false;
+        int camera = it.key().toInt(&ok);
+        QJsonValue cameraRules = it.value().toObject()["rules"];
+        if (ok && cameraRules.isArray()) {
+            p.cameras.insert(camera, rulesOf(cameraRules.toArray()));
+        }
+    }
+    return p;
+}
+
+/**
+ * Returns the rules of a camera, or the default ones if it has no override.
+ * @param camera The index of the camera.
+ */
+QList<ruleTracker::rule> ruleTracker::policy::forCamera(int camera) const {
+    return cameras.value(camera, defaults);
+}
+
+/**
+ * Sets the tracking options and the rules. The tracks are dropped, since
+ * their state machines are compiled from the rules of their camera.
+ * @param rulePolicy The policy, usually read from the "rules" section of the settings.
+ */
+void ruleTracker::setPolicy(const policy &rulePolicy) {
+    this->rulePolicy = rulePolicy;
+    reset(static_cast<int>(cameras.size()), lastTickMs);
+}
+
+/**
+ * Returns the tracking options and the rules.
+ */
+ruleTracker::policy ruleTracker::getPolicy() const {
+    return rulePolicy;
+}
+
+/**
+ * Drops the tracks and resets the alert state for the given number of cameras.
+ * @param count The number of cameras.
+ * @param timestampMs The current timestamp, from which the cooldowns start.
+ */
+void ruleTracker::setCameraCount(int count, qint64 timestampMs) {
+    reset(count, timestampMs);
+}
+
+/**
+ * Tracks a detection and advances the rules of its camera.
+ *
+ * The detection belongs to the oldest track whose first position is within
+ * the tolerance, looked up in the cells around it, or starts a new track named
+ * after the camera and the wall time. Updates after the first confirmAfterS
+ * seconds are counted: they keep the track alive and measure its dwell time.
+ *
+ * Each rule then moves its state machine on the track: Outside while the
+ * detection is out of the zone, Inside from the update that enters it, and
+ * Dwelling once the counted updates span more than dwellS seconds from there.
+ * A rule is evaluated on the camera at most once per cooldownS seconds; an
+ * evaluation raises the alert when the track is dwelling together with at
+ * least count tracks, and sets the camera level to 1 otherwise. Only the state
+ * of this track is touched, so the cost does not grow with the tracked objects.
+ *
+ * @param camera The index of the camera.
+ * @param detected The rectangle of the detection.
+ * @param frameSize The size of the frame, to place the detection in the zones.
+ * @param region The region of interest of the camera, whose polygons are the zones (by id), or nullptr.
+ * @param timestampMs The timestamp of the frame.
+ * @param wallTime The wall time of the frame, used for naming new tracks.
+ * @return The id of the track and whether a rule raised an alert, or an empty id for an unknown camera.
+ */
+ruleTracker::update ruleTracker::track(int camera, const cv::Rect &detected, const cv::Size &frameSize,
+                                       const regionOfInterest *region, qint64 timestampMs, const QTime &wallTime) {
+    if (camera < 0 || camera >= static_cast<int>(cameras.size())) {
+        return update(); // Not set up with setCameraCount
+    }
+
+    cameraState &cam = cameras[camera];
+    const cv::Point position(detected.x, detected.y);
+
+    int index = find(camera, position);
+    bool created = false;
+    if (index < 0) {
+        QString id = QString("CAM%1-%2-%3-%4").arg(camera).arg(wallTime.hour()).arg(wallTime.minute()).arg(wallTime.second());
+
+        // A track started in the same second keeps the id, as the object it names
+        index = ids.value(id, -1);
+        if (index >= 0 && isExpired(index)) {
+            remove(index);
+            index = -1;
+        }
+        if (index < 0) {
+            index = add(camera, id, position, timestampMs);
+            created = true;
+        }
+    }
+
+    trackState &t = tracks[index];
+    if (!created && exceeds(timestampMs - t.startMs, rulePolicy.confirmAfterS)) {
+        t.lastMs = timestampMs;
+    }
+
+    update result;
+    result.id = t.id;
+    bool evaluated = false;
+
+    for (int k = 0; k < cam.rules.size(); k++) {
+        const rule &r = cam.rules.at(k);
+        ruleState &state = t.rules[k];
+
+        const bool inZone = r.zone < 0 || (region && region->polygonContains(r.zone, detected, frameSize));
+        if (!inZone) {
+            if (state.current == Dwelling) {
+                cam.dwelling[k]--;
+            }
+            state.current = Outside;
+            continue;
+        }
+
+        if (state.current == Outside) {
+            state.current = Inside;
+            state.enteredMs = timestampMs;
+        }
+        if (state.current == Inside && exceeds(t.lastMs - state.enteredMs, r.dwellS)) {
+            state.current = Dwelling;
+            cam.dwelling[k]++;
+        }
+
+        if (exceeds(timestampMs - cam.evaluatedMs[k], r.cooldownS)) {
+            cam.evaluatedMs[k] = timestampMs;
+            evaluated = true;
+            if (!result.alert && state.current == Dwelling && cam.dwelling[k] >= r.count) {
+                result.alert = true;
+                result.rule = k;
+            }
+        }
+    }
+
+    if (result.alert) {
+        cam.level = 2;
+    } else if (evaluated || cam.rules.isEmpty()) {
+        cam.level = 1; // Only detection, no alert
+    }
+    return result;
+}
+
+/**
+ * Clears the alert level of a camera, when a frame has no detections.
+ * @param camera The index of the camera.
+ */
+void ruleTracker::clearLevel(int camera) {
+    if (camera >= 0 && camera < static_cast<int>(cameras.size())) {
+        cameras[camera].level = 0;
+    }
+}
+
+/**
+ * Returns the alert level of a camera: 0 no detection, 1 detection, 2 alert.
+ * @param camera The index of the camera.
+ */
+int ruleTracker::level(int camera) const {
+    if (camera < 0 || camera >= static_cast<int>(cameras.size())) {
+        return 0;
+    }
+    return cameras[camera].level;
+}
+
+/**
+ * Drops the tracks without a counted update for more than expireAfterS seconds.
+ * Only the entries of the timer wheel that came due are visited, at most
+ * maxExpiriesPerTick of them; a track whose deadline moved since it was
+ * scheduled is scheduled again. Tracks left for a later tick are already
+ * ignored by the lookups.
+ *
+ * @param timestampMs The timestamp of the tick.
+ */
+void ruleTracker::expire(qint64 timestampMs) {
+    lastTickMs = timestampMs;
+
+    due.clear();
+    wheel.collect(timestampMs, rulePolicy.maxExpiriesPerTick, due);
+    for (const timerWheel::entry &entry : due) {
+        const trackState &t = tracks[entry.item];
+        if (t.camera < 0 || t.generation != entry.generation) {
+            continue; // Removed (and maybe reused) since it was scheduled
+        }
+
+        const qint64 deadline = deadlineOf(t);
+        if (deadline <= timestampMs) {
+            remove(entry.item);
+        } else {
+            wheel.schedule(entry.item, entry.generation, deadline);
+        }
+    }
+}
+
+/**
+ * Returns the number of live tracks, of every camera.
+ */
+int ruleTracker::trackCount() const {
+    return liveTracks;
+}
+
+/**
+ * Drops every track and compiles the rules of each camera.
+ * @param count The number of cameras.
+ * @param timestampMs The current timestamp, from which the cooldowns start.
+ */
+void ruleTracker::reset(int count, qint64 timestampMs) {
+    tracks.clear();
+    freeTracks.clear();
+    ids.clear();
+    liveTracks = 0;
+    wheel.reset(timestampMs);
+    lastTickMs = timestampMs;
+
+    cameras.assign(qMax(0, count), cameraState());
+    for (int i = 0; i < count; i++) {
+        cameraState &cam = cameras[i];
+        cam.rules = rulePolicy.forCamera(i);
+        cam.evaluatedMs.assign(cam.rules.size(), timestampMs);
+        cam.dwelling.assign(cam.rules.size(), 0);
+    }
+}
+
+/**
+ * Looks for the track of a detection: the oldest live one of the camera whose
+ * first position is within the tolerance. The cells are as wide as the
+ * tolerance, so only the cell of the position and its neighbours are visited.
+ *
+ * @param camera The index of the camera.
+ * @param position The top-left corner of the detection.
+ * @return The index of the track, or -1 if there is none.
+ */
+int ruleTracker::find(int camera, const cv::Point &position) const {
+    const cameraState &cam = cameras[camera];
+    const int tolerance = rulePolicy.tolerance;
+
+    int best = -1;
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            auto cell = cam.grid.constFind(cellOf(position, dx, dy));
+            if (cell == cam.grid.constEnd()) {
+                continue;
+            }
+
+            for (int index : *cell) {
+                const trackState &t = tracks[index];
+                if (std::abs(t.head.x - position.x) > tolerance || std::abs(t.head.y - position.y) > tolerance ||
+                    isExpired(index)) {
+                    continue;
+                }
+                if (best < 0 || t.startMs < tracks[best].startMs || (t.startMs == tracks[best].startMs && index < best)) {
+                    best = index;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * Starts a track, in a free slot if there is one, and schedules its expiry.
+ * @return The index of the track.
+ */
+int ruleTracker::add(int camera, const QString &id, const cv::Point &position, qint64 timestampMs) {
+    int index;
+    if (!freeTracks.empty()) {
+        index = freeTracks.back();
+        freeTracks.pop_back();
+    } else {
+        index = static_cast<int>(tracks.size());
+        tracks.emplace_back();
+    }
+
+    trackState &t = tracks[index];
+    t.id = id;
+    t.camera = camera;
+    t.head = position;
+    t.startMs = timestampMs;
+    t.lastMs = timestampMs;
+    t.rules.assign(cameras[camera].rules.size(), ruleState());
+
+    cameras[camera].grid[cellOf(position)].push_back(index);
+    ids.insert(id, index);
+    liveTracks++;
+
+    wheel.schedule(index, t.generation, deadlineOf(t));
+    return index;
+}
+
+/**
+ * Removes a track from the lookups and the zone counts, and frees its slot.
+ * Its entry in the timer wheel is left there and skipped by its generation.
+ * @param index The index of the track.
+ */
+void ruleTracker::remove(int index) {
+    trackState &t = tracks[index];
+    cameraState &cam = cameras[t.camera];
+
+    auto cell = cam.grid.find(cellOf(t.head));
+    if (cell != cam.grid.end()) {
+        std::vector<int> &members = cell.value();
+        for (size_t k = 0; k < members.size(); k++) {
+            if (members[k] == index) {
+                members[k] = members.back();
+                members.pop_back();
+                break;
+            }
+        }
+        if (members.empty()) {
+            cam.grid.erase(cell);
+        }
+    }
+
+    if (ids.value(t.id, -1) == index) {
+        ids.remove(t.id);
+    }
+    for (size_t k = 0; k < t.rules.size(); k++) {
+        if (t.rules[k].current == Dwelling) {
+            cam.dwelling[k]--;
+        }
+    }
+
+    t.id.clear();
+    t.camera = -1;
+    t.generation++;
+    freeTracks.push_back(index);
+    liveTracks--;
+}
+
+/**
+ * Checks if a track should have been dropped by an earlier tick, which left it to a later one.
+ * @param index The index of the track.
+ */
+bool ruleTracker::isExpired(int index) const {
+    return exceeds(lastTickMs - tracks[index].lastMs, rulePolicy.expireAfterS);
+}
+
+/**
+ * Returns the first timestamp at which a track is dropped, if it is not updated before.
+ */
+qint64 ruleTracker::deadlineOf(const trackState &track) const {
+    return track.lastMs + (rulePolicy.expireAfterS + 1) * 1000LL;
+}
+
+/**
+ * Returns the key of the grid cell of a position, or of one of its neighbours.
+ * @param position The position in pixels.
+ * @param dx The horizontal offset, in cells.
+ * @param dy The vertical offset, in cells.
+ */
+quint64 ruleTracker::cellOf(const cv::Point &position, int dx, int dy) const {
+    const int size = qMax(1, rulePolicy.tolerance);
+    auto floorDiv = [size](int value) { return value >= 0 ? value / size : -((-value + size - 1) / size); };
+
+    const quint32 x = static_cast<quint32>(floorDiv(position.x) + dx);
+    const quint32 y = static_cast<quint32>(floorDiv(position.y) + dy);
+    return (static_cast<quint64>(x) << 32) | y;
+}
+
+/**
+ * Checks if more than the given whole seconds have elapsed, as the thresholds
+ * of the rules are written.
+ * @param elapsedMs The elapsed time.
+ * @param seconds The threshold.
+ */
+bool ruleTracker::exceeds(qint64 elapsedMs, int seconds) {
+    return elapsedMs / 1000 > seconds;
+}
@@ -0,0 +1,127 @@
+#ifndef RULETRACKER_H
+#define RULETRACKER_H
+
+#include "regionofinterest.h"
+#include "timerwheel.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTime>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Tracker policy that follows objects by position and raises the alerts of a declarative rule set
+class ruleTracker
+{
+public:
+    // Struct for an alert rule. Times are whole seconds, and a condition holds once more than that many have passed
+    struct rule
+    {
+        QString name = "permanencia";
+        int zone = -1;      // Id of the roi polygon of the camera (shown as Z<id>), -1 for the whole frame
+        int dwellS = 10;    // Time the object must stay in the zone
+        int count = 1;      // Objects that must be dwelling in the zone at once
+        int cooldownS = 2;  // Time between two evaluations of the rule on the camera
+
+        static rule fromJson(const QJsonObject &json);
+    };
+
+    // Struct for the tracking options and the rules
+    struct policy
+    {
+        int tolerance = 50;             // Pixels between the first position of a track and a detection of the same object
+        int confirmAfterS = 1;          // Updates of a track only count once it is older than this
+        int expireAfterS = 5;           // Tracks without a counted update for longer than this are dropped
+        int maxExpiriesPerTick = 4096;  // Tracks dropped per tick at most, the rest wait for the next ticks
+        QList<rule> defaults = {rule()};
+        QHash<int, QList<rule>> cameras; // Overrides from the "rules" array of each camera
+
+        static policy fromJson(const QJsonObject &rules, const QJsonObject &cameras);
+        QList<rule> forCamera(int camera) const;
+    };
+
+    // Struct for the outcome of a detection
+    struct update
+    {
+        QString id;
+        bool alert = false;
+        int rule = -1; // Index of the rule that raised the alert, in the rules of the camera
+    };
+
+    void setPolicy(const policy &rulePolicy);
+    policy getPolicy() const;
+    void setCameraCount(int count, qint64 timestampMs);
+
+    // Main functions
+    update track(int camera, const cv::Rect &detected, const cv::Size &frameSize, const regionOfInterest *region,
+                 qint64 timestampMs, const QTime &wallTime);
+    void clearLevel(int camera);
+    int level(int camera) const;
+    void expire(qint64 timestampMs);
+
+    int trackCount() const;
+
+private:
+    // Stage of a track for a rule
+    enum stage { Outside, Inside, Dwelling };
+
+    // Struct for the state machine of a rule on a track
+    struct ruleState
+    {
+        stage current = Outside;
+        qint64 enteredMs = 0; // Timestamp of the update that entered the zone
+    };
+
+    // Struct for a tracked object, in a slot that is reused once it expires
+    struct trackState
+    {
+        QString id;
+        int camera = -1;      // -1 while the slot is free
+        cv::Point head;       // First position, the one detections are matched against
+        qint64 startMs = 0;
+        qint64 lastMs = 0;    // Last counted update
+        quint32 generation = 0;
+        std::vector<ruleState> rules; // One per rule of the camera
+    };
+
+    // Struct for the compiled rules and the alert level of a camera
+    struct cameraState
+    {
+        QList<rule> rules;
+        std::vector<qint64> evaluatedMs; // Last evaluation of each rule
+        std::vector<int> dwelling;       // Tracks dwelling in the zone of each rule
+        QHash<quint64, std::vector<int>> grid; // Tracks by cell of their first position
+        int level = 0; // 0 no detection, 1 detection, 2 alert
+    };
+
+    policy rulePolicy;
+    std::vector<cameraState> cameras;
+
+    std::vector<trackState> tracks;
+    std::vector<int> freeTracks;
+    QHash<QString, int> ids;
+    int liveTracks = 0;
+
+    // Expiry of the tracks, with one entry per track moved forward lazily
+    timerWheel wheel;
+    std::vector<timerWheel::entry> due;
+    qint64 lastTickMs = 0;
+
+    // Private helper functions
+    void reset(int count, qint64 timestampMs);
+    int find(int camera, const cv::Point &position) const;
+    int add(int camera, const QString &id, const cv::Point &position, qint64 timestampMs);
+    void remove(int index);
+    bool isExpired(int index) const;
+    qint64 deadlineOf(const trackState &track) const;
+    quint64 cellOf(const cv::Point &position, int dx = 0, int dy = 0) const;
+
+    static bool exceeds(qint64 elapsedMs, int seconds);
+};
+
+#endif // RULETRACKER_H
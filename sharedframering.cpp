@@ -0,0 +1,204 @@
+#include "sharedframering.h"
+
+#include <QDebug>
+
+#include <cstring>
+#include <new>
+
+/**
+ * Destructor for sharedFrameRing.
+ * Detaches from the segment; the system removes it when the last process detaches.
+ */
+sharedFrameRing::~sharedFrameRing() {
+    if (memory.isAttached()) {
+        memory.detach();
+    }
+}
+
+/**
+ * Creates the shared segment and initializes the ring.
+ * A segment left behind by a crashed engine is attached and released first.
+ *
+ * @param key The name of the segment, shared with the viewers.
+ * @param cameraCount The number of cameras published.
+ * @param slotsPerCamera How many frames per camera fit in the ring.
+ * @param maxFrameBytes The size of the largest frame (step * rows) that can be published.
+ * @return True if the segment could be created.
+ */
+bool sharedFrameRing::create(const QString &key, int cameraCount, int slotsPerCamera, int maxFrameBytes) {
+    if (cameraCount < 1 || cameraCount > maxCameras) {
+        qWarning() << "Número de cámaras no soportado por el anillo:" << cameraCount;
+        return false;
+    }
+
+    memory.setKey(key);
+
+    // Release a stale segment (Unix keeps it alive after a crash)
+    if (memory.attach()) {
+        memory.detach();
+    }
+
+    if (slotsPerCamera < 1 || maxFrameBytes <= 0) {
+        qWarning() << "Tamaño de anillo inválido:" << slotsPerCamera << "cuadros por cámara de" << maxFrameBytes << "bytes";
+        return false;
+    }
+
+    int slotCount = cameraCount * slotsPerCamera;
+    qsizetype size = sizeof(ringHeader) + qsizetype(slotCount) * slotStride(maxFrameBytes);
+    if (!memory.create(size)) {
+        qWarning() << "No se pudo crear la memoria compartida:" << memory.errorString();
+        return false;
+    }
+
+    std::memset(memory.data(), 0, size);
+    header = new (memory.data()) ringHeader;
+    header->cameraCount = cameraCount;
+    header->slotsPerCamera = slotsPerCamera;
+    header->slotBytes = maxFrameBytes;
+    for (int i = 0; i < maxCameras; i++) {
+        header->writeSequence[i].store(0);
+        header->latestSlot[i].store(-1);
+    }
+    for (int i = 0; i < slotCount; i++) {
+        new (slotAt(i)) slotHeader;
+        slotAt(i)->sequence.store(0);
+    }
+
+    // Written last, viewers ignore the segment until the magic is there
+    header->magic = magicNumber;
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+/**
+ * Publishes an annotated frame and its detection boxes.
+ * The frame goes to the next of the slots of its camera, so a camera that
+ * stops publishing keeps its last frame instead of one of another camera.
+ * The slot is marked as being written (odd sequence) while the pixels are
+ * copied, and becomes the latest slot of its camera once it is complete.
+ *
+ * @param rgbFrame The frame, in RGB, with the detections already drawn.
+ * @param info The camera, timestamp, alert level, scanned fraction and boxes of the frame.
+ * @return False if the ring is not created or the frame does not fit in a slot.
+ */
+bool sharedFrameRing::publish(const cv::Mat &rgbFrame, const frameInfo &info) {
+    if (!header || info.camera < 0 || info.camera >= header->cameraCount) {
+        return false;
+    }
+
+    int step = rgbFrame.cols * 3;
+    if (rgbFrame.type() != CV_8UC3 || qint64(step) * rgbFrame.rows > header->slotBytes) {
+        if (!oversizeReported) {
+            qWarning() << "El cuadro de la cámara" << info.camera << "no cabe en el anillo:"
+                       << rgbFrame.cols << "x" << rgbFrame.rows << "para" << header->slotBytes << "bytes";
+            oversizeReported = true;
+        }
+        return false;
+    }
+
+    const quint64 written = header->writeSequence[info.camera].fetch_add(1);
+    int index = info.camera * header->slotsPerCamera + static_cast<int>(written % header->slotsPerCamera);
+    slotHeader *slot = slotAt(index);
+
+    quint64 sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->camera = info.camera;
+    slot->width = rgbFrame.cols;
+    slot->height = rgbFrame.rows;
+    slot->step = step;
+    slot->timestampMs = info.timestampMs;
+    slot->alertLevel = info.alertLevel;
+    slot->scannedFraction = info.scannedFraction;
+    slot->boxCount = qMin<int>(static_cast<int>(info.boxes.size()), maxBoxes);
+    for (int i = 0; i < slot->boxCount; i++) {
+        slot->boxes[i][0] = info.boxes[i].x;
+        slot->boxes[i][1] = info.boxes[i].y;
+        slot->boxes[i][2] = info.boxes[i].width;
+        slot->boxes[i][3] = info.boxes[i].height;
+    }
+
+    uchar *pixels = pixelsAt(index);
+    for (int y = 0; y < rgbFrame.rows; y++) {
+        std::memcpy(pixels + qsizetype(y) * step, rgbFrame.ptr(y), step);
+    }
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    header->latestSlot[info.camera].store(index, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Attaches to the ring created by the engine, read only.
+ * Any number of viewers can attach; reading does not involve the engine.
+ *
+ * @param key The name of the segment.
+ * @return True if the segment exists and contains an initialized ring.
+ */
+bool sharedFrameRing::attach(const QString &key) {
+    memory.setKey(key);
+    if (!memory.attach(QSharedMemory::ReadOnly)) {
+        qWarning() << "No se pudo acceder a la memoria compartida:" << memory.errorString();
+        return false;
+    }
+
+    ringHeader *candidate = static_cast<ringHeader *>(memory.data());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (candidate->magic != magicNumber) {
+        qWarning() << "La memoria compartida no contiene un anillo de cuadros válido.";
+        memory.detach();
+        return false;
+    }
+
+    header = candidate;
+    return true;
+}
+
+/**
+ * Returns the number of cameras published in the ring, or 0 if not attached.
+ */
+int sharedFrameRing::cameraCount() const {
+    return header ? header->cameraCount : 0;
+}
+
+/**
+ * Returns the sequence of the latest frame of a camera, used by the viewers
+ * to skip frames they have already displayed.
+ * @param camera The index of the camera.
+ * @return The sequence, or 0 if nothing was published yet.
+ */
+quint64 sharedFrameRing::latestSequence(int camera) const {
+    if (!header || camera < 0 || camera >= header->cameraCount) {
+        return 0;
+    }
+
+    int index = header->latestSlot[camera].load(std::memory_order_acquire);
+    if (index < 0) {
+        return 0;
+    }
+    return (quint64(index) << 48) ^ slotAt(index)->sequence.load(std::memory_order_acquire);
+}
+
+/**
+ * Returns the size of a slot (header and pixels), rounded up to a cache line.
+ */
+int sharedFrameRing::slotStride(int slotBytes) {
+    int size = static_cast<int>(sizeof(slotHeader)) + slotBytes;
+    return (size + 63) & ~63;
+}
+
+/**
+ * Returns the header of a slot.
+ */
+sharedFrameRing::slotHeader *sharedFrameRing::slotAt(int index) const {
+    uchar *base = static_cast<uchar *>(const_cast<void *>(memory.constData())) + sizeof(ringHeader);
+    return reinterpret_cast<slotHeader *>(base + qsizetype(index) * slotStride(header->slotBytes));
+}
+
+/**
+ * Returns the pixels of a slot, right after its header.
+ */
+uchar *sharedFrameRing::pixelsAt(int index) const {
+    return reinterpret_cast<uchar *>(slotAt(index)) + sizeof(slotHeader);
+}
@@ -0,0 +1,127 @@
+#ifndef SHAREDFRAMERING_H
+#define SHAREDFRAMERING_H
+
+#include <QSharedMemory>
+#include <QString>
+#include <QImage>
+
+#include <atomic>
+
+#include <opencv2/opencv.hpp>
+
+// Class for a ring of annotated frames in shared memory, written by the engine and read by the viewers
+class sharedFrameRing
+{
+public:
+    static const int maxCameras = 16;
+    static const int maxBoxes = 32;
+
+    // Struct for the metadata of a published frame
+    struct frameInfo
+    {
+        int camera = -1;
+        qint64 timestampMs = 0;
+        int alertLevel = 0;
+        double scannedFraction = 1.0; // Fraction of the frame pixels given to the detector
+        std::vector<cv::Rect> boxes;
+    };
+
+    ~sharedFrameRing();
+
+    // Engine side
+    bool create(const QString &key, int cameraCount, int slotsPerCamera, int maxFrameBytes);
+    bool publish(const cv::Mat &rgbFrame, const frameInfo &info);
+
+    // Viewer side
+    bool attach(const QString &key);
+    int cameraCount() const;
+    quint64 latestSequence(int camera) const;
+    template <typename Consumer> bool read(int camera, Consumer consume) const;
+
+private:
+    // Struct for the ring header, at the start of the segment
+    struct ringHeader
+    {
+        quint32 magic;
+        qint32 cameraCount;
+        qint32 slotsPerCamera; // Each camera writes only to its own slots
+        qint32 slotBytes;
+        std::atomic<quint64> writeSequence[maxCameras];
+        std::atomic<qint32> latestSlot[maxCameras];
+    };
+
+    // Struct for the header of a slot, followed by the pixels
+    struct slotHeader
+    {
+        std::atomic<quint64> sequence; // Odd while the slot is being written
+        qint32 camera;
+        qint32 width;
+        qint32 height;
+        qint32 step;
+        qint64 timestampMs;
+        qint32 alertLevel;
+        double scannedFraction;
+        qint32 boxCount;
+        qint32 boxes[maxBoxes][4];
+    };
+
+    static const quint32 magicNumber = 0x52494e47; // "RING"
+
+    QSharedMemory memory;
+    ringHeader *header = nullptr;
+    bool oversizeReported = false;
+
+    // Private helper functions
+    static int slotStride(int slotBytes);
+    slotHeader *slotAt(int index) const;
+    uchar *pixelsAt(int index) const;
+};
+
+/**
+ * Reads the latest frame of a camera without copying it.
+ *
+ * The consumer is called with a QImage that points straight into the shared
+ * segment and the frame metadata; it must copy whatever it keeps (e.g. by
+ * converting the image to a pixmap). The slot is guarded by a sequence lock:
+ * if the engine overwrote it while it was being read this returns false, and
+ * whatever the consumer produced must be dropped. The slots of a camera are
+ * only written with its own frames; a slot of another camera is rejected as well.
+ *
+ * @param camera The index of the camera.
+ * @param consume Callable taking (const QImage &, const frameInfo &).
+ * @return True if a consistent frame was handed to the consumer.
+ */
+template <typename Consumer>
+bool sharedFrameRing::read(int camera, Consumer consume) const {
+    if (!header || camera < 0 || camera >= header->cameraCount) {
+        return false;
+    }
+
+    int index = header->latestSlot[camera].load(std::memory_order_acquire);
+    if (index < 0) {
+        return false;
+    }
+
+    slotHeader *slot = slotAt(index);
+    quint64 before = slot->sequence.load(std::memory_order_acquire);
+    if ((before & 1) || slot->camera != camera) {
+        return false;
+    }
+
+    frameInfo info;
+    info.camera = slot->camera;
+    info.timestampMs = slot->timestampMs;
+    info.alertLevel = slot->alertLevel;
+    info.scannedFraction = slot->scannedFraction;
+    for (int i = 0; i < slot->boxCount && i < maxBoxes; i++) {
+        info.boxes.emplace_back(slot->boxes[i][0], slot->boxes[i][1], slot->boxes[i][2], slot->boxes[i][3]);
+    }
+
+    QImage image(pixelsAt(index), slot->width, slot->height, slot->step, QImage::Format_RGB888);
+    consume(image, info);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == before;
+}
+
+#endif // SHAREDFRAMERING_H
@@ -0,0 +1,108 @@
+#include "snapshotdeduplicator.h"
+
+#include <QtAlgorithms>
+#include <algorithm>
+
+/**
+ * Computes the difference hash (dHash) of an image.
+ * The image is reduced to 9x8 grayscale pixels and each bit of the hash tells
+ * whether a pixel is brighter than its right neighbour, so the hash survives
+ * small changes of scale, brightness and compression.
+ *
+ * @param image The image (or region of a frame) to hash, in RGB or grayscale.
+ * @return The 64 bit hash, or 0 if the image is empty.
+ */
+quint64 snapshotDeduplicator::dHash(const cv::Mat &image) {
+    if (image.empty()) {
+        return 0;
+    }
+
+    cv::Mat gray, small;
+    if (image.channels() == 1) {
+        gray = image;
+    } else {
+        cv::cvtColor(image, gray, cv::COLOR_RGB2GRAY);
+    }
+    cv::resize(gray, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+
+    quint64 hash = 0;
+    for (int y = 0; y < 8; y++) {
+        const uchar *row = small.ptr<uchar>(y);
+        for (int x = 0; x < 8; x++) {
+            hash = (hash << 1) | (row[x] > row[x + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+/**
+ * Returns the Hamming distance between two hashes.
+ */
+int snapshotDeduplicator::distance(quint64 h1, quint64 h2) {
+    return qPopulationCount(h1 ^ h2);
+}
+
+/**
+ * Looks for a recent alert of the same camera with a similar hash.
+ * When one is found its last seen time is refreshed, so an object that stays
+ * in place keeps merging into the same alert.
+ *
+ * @param camera The index of the camera.
+ * @param hash The hash of the new alert crop.
+ * @param timestampMs The timestamp of the frame.
+ * @return The id of the existing alert, or an empty string if there is none.
+ */
+QString snapshotDeduplicator::findDuplicate(int camera, quint64 hash, qint64 timestampMs) {
+    auto it = recentAlerts.find(camera);
+    if (it == recentAlerts.end()) {
+        return QString();
+    }
+
+    QQueue<recentAlert> &queue = it.value();
+    expire(queue, timestampMs);
+
+    // Closest match wins
+    int best = -1;
+    int bestDistance = maxDistance + 1;
+    for (int i = 0; i < queue.size(); i++) {
+        int d = distance(queue[i].hash, hash);
+        if (d < bestDistance) {
+            best = i;
+            bestDistance = d;
+        }
+    }
+
+    if (best < 0) {
+        return QString();
+    }
+
+    queue[best].lastSeenMs = timestampMs;
+    return queue[best].id;
+}
+
+/**
+ * Adds a new alert to the index of its camera, dropping the oldest one if full.
+ * @param camera The index of the camera.
+ * @param hash The hash of the alert crop.
+ * @param id The id of the alert.
+ * @param timestampMs The timestamp of the frame.
+ */
+void snapshotDeduplicator::addAlert(int camera, quint64 hash, const QString &id, qint64 timestampMs) {
+    QQueue<recentAlert> &queue = recentAlerts[camera];
+    queue.enqueue({hash, id, timestampMs});
+
+    if (queue.size() > maxAlertsPerCamera) {
+        queue.dequeue();
+    }
+}
+
+/**
+ * Removes the alerts that have not been seen within the window.
+ * @param queue The recent alerts of a camera.
+ * @param timestampMs The timestamp of the current frame.
+ */
+void snapshotDeduplicator::expire(QQueue<recentAlert> &queue, qint64 timestampMs) {
+    queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const recentAlert &alert) {
+                    return timestampMs - alert.lastSeenMs > windowMs;
+                }), queue.end());
+}
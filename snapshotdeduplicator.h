@@ -0,0 +1,42 @@
+#ifndef SNAPSHOTDEDUPLICATOR_H
+#define SNAPSHOTDEDUPLICATOR_H
+
+#include <QHash>
+#include <QQueue>
+#include <QString>
+
+#include <opencv2/opencv.hpp>
+
+// Class to find alerts whose snapshot is nearly identical to a recent one of the same camera
+class snapshotDeduplicator
+{
+public:
+    // Perceptual hash of an image region
+    static quint64 dHash(const cv::Mat &image);
+    static int distance(quint64 h1, quint64 h2);
+
+    QString findDuplicate(int camera, quint64 hash, qint64 timestampMs);
+    void addAlert(int camera, quint64 hash, const QString &id, qint64 timestampMs);
+
+private:
+    // Struct for a recent alert in the index
+    struct recentAlert
+    {
+        quint64 hash;
+        QString id;
+        qint64 lastSeenMs;
+    };
+
+    // Recent alerts per camera, oldest first
+    QHash<int, QQueue<recentAlert>> recentAlerts;
+
+    // Tuning
+    const int maxDistance = 10;       // Maximum differing bits (of 64) to consider two crops the same
+    const qint64 windowMs = 120000;   // How long an alert can absorb duplicates since it was last seen
+    const int maxAlertsPerCamera = 32;
+
+    // Private helper functions
+    void expire(QQueue<recentAlert> &queue, qint64 timestampMs);
+};
+
+#endif // SNAPSHOTDEDUPLICATOR_H
@@ -0,0 +1,176 @@
+#include "snapshotwriter.h"
+
+#include <QFile>
+#include <QDebug>
+
+/**
+ * Builds a policy from its JSON representation.
+ * Missing or unknown values keep their defaults (full frame PNG), which is
+ * what the application did before snapshots were configurable.
+ *
+ * @param json The "snapshot" section of the configuration.
+ * @return The policy described by the JSON object.
+ */
+snapshotWriter::policy snapshotWriter::policy::fromJson(const QJsonObject &json) {
+    policy p;
+
+    p.area = json["region"].toString() == "crop" ? Crop : FullFrame;
+    p.padding = qBound(0, json["padding"].toInt(p.padding), 200);
+
+    QString format = json["format"].toString("png");
+    if (format == "jpeg" || format == "jpg") {
+        p.encoding = Jpeg;
+    } else if (format == "webp") {
+        p.encoding = Webp;
+    } else {
+        p.encoding = Png;
+    }
+
+    p.quality = qBound(1, json["quality"].toInt(p.quality), 100);
+    p.pngCompression = qBound(0, json["pngCompression"].toInt(p.pngCompression), 9);
+    p.thumbnail = json["thumbnail"].toBool(p.thumbnail);
+    p.thumbnailWidth = qMax(16, json["thumbnailWidth"].toInt(p.thumbnailWidth));
+    return p;
+}
+
+/**
+ * Converts the policy to its JSON representation.
+ */
+QJsonObject snapshotWriter::policy::toJson() const {
+    QJsonObject json;
+    json["region"] = area == Crop ? "crop" : "full";
+    json["padding"] = padding;
+    json["format"] = extension();
+    json["quality"] = quality;
+    json["pngCompression"] = pngCompression;
+    json["thumbnail"] = thumbnail;
+    json["thumbnailWidth"] = thumbnailWidth;
+    return json;
+}
+
+/**
+ * Returns the file extension of the encoding, without the dot.
+ */
+QString snapshotWriter::policy::extension() const {
+    switch (encoding) {
+    case Jpeg:
+        return "jpg";
+    case Webp:
+        return "webp";
+    default:
+        return "png";
+    }
+}
+
+/**
+ * Returns a short readable name of the policy, used by the benchmark.
+ */
+QString snapshotWriter::policy::name() const {
+    QString level = encoding == Png ? QString("c%1").arg(pngCompression) : QString("q%1").arg(quality);
+    return QString("%1 %2 %3").arg(QString(area == Crop ? "crop" : "full"), extension(), level);
+}
+
+/**
+ * Returns the OpenCV encoder parameters of the policy.
+ */
+std::vector<int> snapshotWriter::policy::encodeParams() const {
+    switch (encoding) {
+    case Jpeg:
+        return {cv::IMWRITE_JPEG_QUALITY, quality};
+    case Webp:
+        return {cv::IMWRITE_WEBP_QUALITY, quality};
+    default:
+        return {cv::IMWRITE_PNG_COMPRESSION, pngCompression};
+    }
+}
+
+/**
+ * Sets the policy used for the next snapshots.
+ */
+void snapshotWriter::setPolicy(const policy &snapshotPolicy) {
+    this->snapshotPolicy = snapshotPolicy;
+}
+
+/**
+ * Returns the policy used for the snapshots.
+ */
+snapshotWriter::policy snapshotWriter::getPolicy() const {
+    return snapshotPolicy;
+}
+
+/**
+ * Writes the snapshot of an alert, and its thumbnail if enabled.
+ * @param rgbFrame The frame where the alert was raised, in RGB.
+ * @param detection The rectangle of the detection that raised the alert.
+ * @param basePath The path of the snapshot without extension.
+ * @return The path of the written snapshot, or an empty string if it could not be written.
+ */
+QString snapshotWriter::write(const cv::Mat &rgbFrame, const cv::Rect &detection, const QString &basePath) {
+    prepare(rgbFrame, detection, converted);
+    const cv::Mat &image = converted;
+    QString path = QString("%1.%2").arg(basePath, snapshotPolicy.extension());
+
+    std::vector<uchar> &buffer = encoded;
+    buffer.clear();
+    if (!encode(image, buffer)) {
+        qWarning() << "No se pudo codificar la imagen:" << path;
+        return QString();
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "No se pudo guardar el archivo:" << path;
+        return QString();
+    }
+    file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<qint64>(buffer.size()));
+    file.close();
+
+    if (snapshotPolicy.thumbnail && image.cols > snapshotPolicy.thumbnailWidth) {
+        cv::Mat thumbnail;
+        double scale = double(snapshotPolicy.thumbnailWidth) / image.cols;
+        cv::resize(image, thumbnail, cv::Size(), scale, scale, cv::INTER_AREA);
+        cv::imwrite(QString("%1_thumb.jpg").arg(basePath).toStdString(), thumbnail, {cv::IMWRITE_JPEG_QUALITY, 75});
+    }
+
+    return path;
+}
+
+/**
+ * Crops the frame according to the policy and converts it to BGR for encoding.
+ * Cropping first means only the region that is kept gets converted.
+ *
+ * @param rgbFrame The frame, in RGB.
+ * @param detection The rectangle of the detection.
+ * @param bgrImage The output image ready to be encoded, in BGR; its buffer is reused when the size matches.
+ */
+void snapshotWriter::prepare(const cv::Mat &rgbFrame, const cv::Rect &detection, cv::Mat &bgrImage) const {
+    cv::Mat region = rgbFrame;
+
+    if (snapshotPolicy.area == policy::Crop) {
+        int padX = detection.width * snapshotPolicy.padding / 100;
+        int padY = detection.height * snapshotPolicy.padding / 100;
+        cv::Rect padded(detection.x - padX, detection.y - padY, detection.width + 2 * padX, detection.height + 2 * padY);
+        padded &= cv::Rect(0, 0, rgbFrame.cols, rgbFrame.rows);
+
+        if (!padded.empty()) {
+            region = rgbFrame(padded);
+        }
+    }
+
+    cv::cvtColor(region, bgrImage, cv::COLOR_RGB2BGR);
+}
+
+/**
+ * Encodes an image in memory with the format and quality of the policy.
+ * @param bgrImage The image to encode, in BGR.
+ * @param buffer The output buffer with the encoded bytes.
+ * @return True if the image could be encoded (WebP needs OpenCV built with it).
+ */
+bool snapshotWriter::encode(const cv::Mat &bgrImage, std::vector<uchar> &buffer) const {
+    try {
+        return cv::imencode("." + snapshotPolicy.extension().toStdString(), bgrImage, buffer, snapshotPolicy.encodeParams());
+    } catch (const cv::Exception &e) {
+        qWarning() << "Error del codificador:" << e.what();
+        return false;
+    }
+}
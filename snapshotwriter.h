@@ -0,0 +1,50 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <QString>
+#include <QJsonObject>
+
+#include <opencv2/opencv.hpp>
+
+// Class to encode and write alert snapshots according to a configurable policy
+class snapshotWriter
+{
+public:
+    // Struct for the snapshot options
+    struct policy
+    {
+        enum region { FullFrame, Crop };
+        enum format { Png, Jpeg, Webp };
+
+        region area = FullFrame;
+        int padding = 20;          // Extra margin around the crop, in percent of the detection size
+        format encoding = Png;
+        int quality = 90;          // JPEG/WebP quality (1-100)
+        int pngCompression = 1;    // PNG compression level (0-9)
+        bool thumbnail = false;    // Also write a small JPEG next to the snapshot
+        int thumbnailWidth = 160;
+
+        static policy fromJson(const QJsonObject &json);
+        QJsonObject toJson() const;
+        QString extension() const;
+        QString name() const;
+        std::vector<int> encodeParams() const;
+    };
+
+    void setPolicy(const policy &snapshotPolicy);
+    policy getPolicy() const;
+
+    // Main functions
+    QString write(const cv::Mat &rgbFrame, const cv::Rect &detection, const QString &basePath);
+    void prepare(const cv::Mat &rgbFrame, const cv::Rect &detection, cv::Mat &bgrImage) const;
+    bool encode(const cv::Mat &bgrImage, std::vector<uchar> &buffer) const;
+
+private:
+    policy snapshotPolicy;
+
+    // Buffers reused between snapshots (full frame snapshots keep the same size)
+    cv::Mat converted;
+    std::vector<uchar> encoded;
+};
+
+#endif // SNAPSHOTWRITER_H
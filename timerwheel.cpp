@@ -0,0 +1,92 @@
+#include "timerwheel.h"
+
+/**
+ * Constructor for timerWheel.
+ * Deadlines further than granularityMs * slotCount stay in their slot and are
+ * skipped on each turn until they are due.
+ * @param granularityMs The time covered by a slot.
+ * @param slotCount The number of slots of the ring.
+ */
+timerWheel::timerWheel(int granularityMs, int slotCount)
+    : granularityMs(qMax(1, granularityMs)), slots(qMax(1, slotCount)) {}
+
+/**
+ * Drops every entry and starts the wheel at the given time.
+ * @param nowMs The current timestamp.
+ */
+void timerWheel::reset(qint64 nowMs) {
+    for (std::vector<entry> &slot : slots) {
+        slot.clear();
+    }
+    cursor = tickOf(nowMs);
+    pending = 0;
+}
+
+/**
+ * Schedules an item. A deadline already past is collected by the next call to collect.
+ * @param item The index of the item, for the caller.
+ * @param generation The generation of the item when it was scheduled.
+ * @param deadlineMs The timestamp from which the item is due.
+ */
+void timerWheel::schedule(int item, quint32 generation, qint64 deadlineMs) {
+    const qint64 tick = qMax(tickOf(deadlineMs), cursor);
+    slots[tick % static_cast<qint64>(slots.size())].push_back({item, generation, deadlineMs});
+    pending++;
+}
+
+/**
+ * Moves the due entries out of the wheel, visiting only the slots of the
+ * ticks since the last call (every slot once at most).
+ * When maxEntries is reached the rest stays for the next call, so a burst of
+ * deadlines is spread over several ticks instead of stalling one.
+ *
+ * @param nowMs The current timestamp; entries with a deadline up to it are due.
+ * @param maxEntries The most entries moved by this call.
+ * @param due The vector where the due entries are appended.
+ * @return The number of entries appended.
+ */
+int timerWheel::collect(qint64 nowMs, int maxEntries, std::vector<entry> &due) {
+    const qint64 nowTick = tickOf(nowMs);
+    if (nowTick < cursor) {
+        return 0;
+    }
+
+    const qint64 slotCount = static_cast<qint64>(slots.size());
+    int collected = 0;
+    for (qint64 tick = qMax(cursor, nowTick - slotCount + 1); tick <= nowTick; tick++) {
+        std::vector<entry> &slot = slots[tick % slotCount];
+        for (size_t k = 0; k < slot.size();) {
+            if (slot[k].deadlineMs > nowMs) {
+                k++; // A later turn of the wheel
+                continue;
+            }
+            if (collected == maxEntries) {
+                cursor = tick;
+                return collected;
+            }
+            due.push_back(slot[k]);
+            slot[k] = slot.back();
+            slot.pop_back();
+            collected++;
+            pending--;
+        }
+    }
+
+    // The slot of the current tick can still receive due entries before it ends
+    cursor = nowTick;
+    return collected;
+}
+
+/**
+ * Returns the number of scheduled entries, due or not.
+ */
+int timerWheel::size() const {
+    return pending;
+}
+
+/**
+ * Returns the tick (slot time) of a timestamp.
+ */
+qint64 timerWheel::tickOf(qint64 timeMs) const {
+    return timeMs / granularityMs;
+}
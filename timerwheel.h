@@ -0,0 +1,37 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+// Class for deadlines bucketed in a ring of slots, so collecting the due ones costs those entries instead of a scan of all
+class timerWheel
+{
+public:
+    // Struct for a scheduled deadline; the generation tells a live item from a reused slot of the caller
+    struct entry
+    {
+        int item;
+        quint32 generation;
+        qint64 deadlineMs;
+    };
+
+    explicit timerWheel(int granularityMs = 100, int slotCount = 256);
+
+    void reset(qint64 nowMs);
+    void schedule(int item, quint32 generation, qint64 deadlineMs);
+    int collect(qint64 nowMs, int maxEntries, std::vector<entry> &due);
+    int size() const;
+
+private:
+    int granularityMs;
+    std::vector<std::vector<entry>> slots;
+    qint64 cursor = 0; // First tick whose slot may still hold due entries
+    int pending = 0;
+
+    // Private helper functions
+    qint64 tickOf(qint64 timeMs) const;
+};
+
+#endif // TIMERWHEEL_H